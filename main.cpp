@@ -1,5 +1,11 @@
+#include <filesystem>
+#include <fstream>
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 // opencv
 #include <opencv2/opencv.hpp>
@@ -20,10 +26,15 @@ int main(int argc, char* argv[]) {
     std::cout << "sea_vision.exe started" << std::endl;
 
     // check command line arguments
-    if (argc < 4 || argc > 5) {
-        std::cout << "usage: " << argv[0] << " <pipeline.json> <input_image> <output_image> [--graph]" << std::endl;
+    auto print_usage = [&argv]() {
+        std::cout << "usage: " << argv[0] << " <pipeline.json> <input_image> <output_image> [--graph] [--parallel | --dataflow] [--tiled] [--tile-size <px>] [--stream | --batch] [--budget <ms>] [--kernel-threads adaptive|serial|unmanaged]" << std::endl;
         std::cout << "example: " << argv[0] << " tests/json/test_pipeline.json data/input.jpg output.jpg" << std::endl;
         std::cout << "example: " << argv[0] << " tests/json/test_graph.json data/input.jpg output.jpg --graph" << std::endl;
+        std::cout << "example: " << argv[0] << " tests/json/test_graph.json data/input.jpg output.jpg --graph --parallel" << std::endl;
+        std::cout << "example: " << argv[0] << " tests/json/test_graph.json images.txt output_dir --batch" << std::endl;
+    };
+    if (argc < 4) {
+        print_usage();
         return -1;
     }
 
@@ -31,13 +42,93 @@ int main(int argc, char* argv[]) {
     std::string pipeline_file = argv[1];
     std::string input_image = argv[2];
     std::string output_image = argv[3];
-    bool use_graph = (argc == 5 && std::string(argv[4]) == "--graph");
+    bool use_graph = false;
+    bool use_parallel = false;
+    bool use_dataflow = false;
+    bool use_tiles = false;
+    int tile_size = GraphExecutor::default_tile_size;
+    bool use_stream = false;
+    bool use_batch = false;
+    int budget_ms = 0;
+    std::string kernel_threads = "adaptive";
+    for (int i = 4; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--graph") {
+            use_graph = true;
+        } else if (flag == "--parallel") {
+            // parallel execution is only available for graphs
+            use_graph = true;
+            use_parallel = true;
+        } else if (flag == "--dataflow") {
+            use_graph = true;
+            use_dataflow = true;
+        } else if (flag == "--tiled") {
+            // tiled chains are only available for graphs
+            use_graph = true;
+            use_tiles = true;
+        } else if (flag == "--stream") {
+            // streams the graph's inputs repeatedly through a stage pipeline (benchmark)
+            use_graph = true;
+            use_stream = true;
+        } else if (flag == "--batch") {
+            // input_image is a list of images (one path per line), output_image a directory
+            use_graph = true;
+            use_batch = true;
+        } else if (flag == "--budget" || flag == "--kernel-threads" || flag == "--tile-size") {
+            if (i + 1 >= argc) {
+                std::cerr << "error: option " << flag << " needs a value" << std::endl;
+                return -1;
+            }
+            std::string value = argv[++i];
+            use_graph = true;
+            if (flag == "--kernel-threads") {
+                // threads of opencv's own kernels next to the graph's workers (benchmark)
+                kernel_threads = value;
+                continue;
+            }
+            
+            char* end = nullptr;
+            errno = 0;
+            long number = std::strtol(value.c_str(), &end, 10);
+            if (flag == "--tile-size") {
+                // tile edge length in pixels for --tiled (implies it)
+                if (value.empty() || *end != '\0' || errno == ERANGE || number < 16 || number > 16384) {
+                    std::cerr << "error: --tile-size needs a whole number of pixels between 16 and 16384, got '"
+                              << value << "'" << std::endl;
+                    return -1;
+                }
+                use_tiles = true;
+                tile_size = static_cast<int>(number);
+                continue;
+            }
+            
+            // per-frame time budget: optional nodes are shed once it would be overrun
+            if (value.empty() || *end != '\0' || errno == ERANGE || number <= 0 || number > 3600000) {
+                std::cerr << "error: --budget needs a whole number of milliseconds between 1 and 3600000, got '"
+                          << value << "'" << std::endl;
+                return -1;
+            }
+            budget_ms = static_cast<int>(number);
+        } else {
+            std::cerr << "error: unknown option '" << flag << "'" << std::endl;
+            print_usage();
+            return -1;
+        }
+    }
+    if (use_parallel && use_dataflow) {
+        std::cerr << "error: --parallel and --dataflow exclude each other" << std::endl;
+        return -1;
+    }
+    if (use_stream && use_batch) {
+        std::cerr << "error: --stream and --batch exclude each other" << std::endl;
+        return -1;
+    }
     
     std::cout << "starting sea vision json-driven pipeline..." << std::endl;
     std::cout << "pipeline config: " << pipeline_file << std::endl;
     std::cout << "input image: " << input_image << std::endl;
     std::cout << "output image: " << output_image << std::endl;
-    std::cout << "execution mode: " << (use_graph ? "graph-based" : "linear") << std::endl;
+    std::cout << "execution mode: " << (use_graph ? (use_batch ? "graph-based (batch)" : use_stream ? "graph-based (streaming)" : use_dataflow ? "graph-based (dataflow)" : use_parallel ? "graph-based (parallel)" : "graph-based") : "linear") << std::endl;
     
     // execute pipeline
     try {
@@ -46,28 +137,125 @@ int main(int argc, char* argv[]) {
             std::cout << "executing graph-based pipeline..." << std::endl;
             
             GraphExecutor executor;
+            if (use_tiles) {
+                executor.setTileSize(tile_size);
+            }
             executor.loadGraph(pipeline_file);
+            executor.setTimeBudget(std::chrono::milliseconds(budget_ms));
+            if (use_dataflow) {
+                executor.setExecutionMode(ExecutionMode::Dataflow);
+            } else if (use_parallel) {
+                executor.setExecutionMode(ExecutionMode::Parallel);
+            }
+            if (kernel_threads == "serial") {
+                executor.setKernelThreading(KernelThreading::Serial);
+            } else if (kernel_threads == "unmanaged") {
+                executor.setKernelThreading(KernelThreading::Unmanaged);
+            } else if (kernel_threads != "adaptive") {
+                std::cerr << "error: unknown kernel threading '" << kernel_threads << "'" << std::endl;
+                return -1;
+            }
+            
+            if (use_batch) {
+                std::ifstream list(input_image);
+                if (!list.is_open()) {
+                    std::cerr << "error: could not open image list '" << input_image << "'" << std::endl;
+                    return -1;
+                }
+                
+                // every result is saved under the file name of its input
+                std::filesystem::create_directories(output_image);
+                std::vector<BatchItem> items;
+                std::string line;
+                while (std::getline(list, line)) {
+                    if (!line.empty() && line.back() == '\r') {
+                        line.pop_back();
+                    }
+                    if (!line.empty()) {
+                        std::filesystem::path output_path = std::filesystem::path(output_image) / std::filesystem::path(line).filename();
+                        items.push_back(BatchItem{line, output_path.string()});
+                    }
+                }
+                
+                BatchOptions batch_options;
+                batch_options.time_budget = std::chrono::milliseconds(budget_ms);
+                BatchStats batch_stats = executor.executeBatch(items, batch_options);
+                for (const auto& failure : batch_stats.failures) {
+                    std::cerr << "error: " << failure.first << ": " << failure.second << std::endl;
+                }
+                std::cout << "batch execution completed!" << std::endl;
+                std::cout << "  images: " << batch_stats.images << std::endl;
+                std::cout << "  saved: " << batch_stats.saved << std::endl;
+                std::cout << "  rejected: " << batch_stats.rejected << std::endl;
+                std::cout << "  failed: " << batch_stats.failed << std::endl;
+                std::cout << "  execution time: " << batch_stats.total_time.count() << "ms" << std::endl;
+                std::cout << "  throughput: " << batch_stats.throughput << " images/s" << std::endl;
+                return batch_stats.failed == 0 ? 0 : -1;
+            }
             
-            // execute with progress reporting
-            cv::Mat result = executor.executeWithProgress(
-                [](const std::string& node_name, int current, int total) {
-                    std::cout << "  executing node " << current << "/" << total << ": " << node_name << std::endl;
+            cv::Mat result;
+            GraphExecutor::ExecutionStats stats;
+            if (use_stream) {
+                // run 32 frames through the stage pipeline, keeping the last result
+                int frames_left = 32;
+                StreamOptions stream_options;
+                stream_options.time_budget = std::chrono::milliseconds(budget_ms);
+                StreamStats stream_stats = executor.executeStream(
+                    [&frames_left](ExecutionContext&) { return frames_left-- > 0; },
+                    [&result, &stats](ExecutionContext& context) {
+                        result = context.getResult().clone();
+                        stats = context.getStats();
+                    },
+                    stream_options
+                );
+                
+                for (size_t i = 0; i < stream_stats.stage_nodes.size(); ++i) {
+                    std::cout << "  stage " << (i + 1) << " (" << stream_stats.stage_costs_ms[i] << "ms):";
+                    for (const auto& node_id : stream_stats.stage_nodes[i]) {
+                        std::cout << " " << node_id;
+                    }
+                    std::cout << std::endl;
                 }
-            );
+                std::cout << "  streamed frames: " << stream_stats.frames << " in " << stream_stats.total_time.count() << "ms" << std::endl;
+                std::cout << "  throughput: " << stream_stats.throughput << " frames/s" << std::endl;
+                std::cout << "  latency: " << stream_stats.mean_latency_ms << "ms mean, " << stream_stats.max_latency_ms << "ms max" << std::endl;
+            } else {
+                // execute with progress reporting
+                result = executor.executeWithProgress(
+                    [](const std::string& node_name, int current, int total) {
+                        std::cout << "  executing node " << current << "/" << total << ": " << node_name << std::endl;
+                    }
+                );
+                stats = executor.getExecutionStats();
+            }
             
-            // save result
-            std::cout << "saving result..." << std::endl;
-            if (!cv::imwrite(output_image, result)) {
-                std::cerr << "error: could not save image to '" << output_image << "'" << std::endl;
-                return -1;
+            // a rejected frame (or a result switched off by a failed check) has no image to save
+            if (stats.rejected) {
+                std::cout << "frame rejected by: " << stats.rejected_by << std::endl;
+            } else if (result.empty()) {
+                std::cout << "result skipped by a failed check, nothing saved" << std::endl;
+            } else {
+                std::cout << "saving result..." << std::endl;
+                if (!cv::imwrite(output_image, result)) {
+                    std::cerr << "error: could not save image to '" << output_image << "'" << std::endl;
+                    return -1;
+                }
             }
             
             // print execution stats
-            auto stats = executor.getExecutionStats();
             std::cout << "graph execution completed!" << std::endl;
             std::cout << "  total nodes: " << stats.total_nodes << std::endl;
             std::cout << "  executed nodes: " << stats.executed_nodes << std::endl;
+            std::cout << "  skipped nodes: " << stats.skipped_nodes << std::endl;
+            if (stats.degraded) {
+                std::cout << "  shed nodes: " << stats.shed_nodes << " (frame degraded to meet the budget)" << std::endl;
+            }
             std::cout << "  execution time: " << stats.execution_time.count() << "ms" << std::endl;
+            std::cout << "  peak image memory: " << (stats.peak_image_bytes / 1024) << "KB" << std::endl;
+            
+            if (result.empty()) {
+                return 0;
+            }
             
         } else {
             // execute linear pipeline (original code)
@@ -91,26 +279,54 @@ int main(int argc, char* argv[]) {
             std::cout << "executing pipeline with " << config.operations.size() << " operations..." << std::endl;
             cv::Mat result = image.clone();
             
+            // create operations using factory, and check their parameters before any step runs
+            std::vector<std::unique_ptr<Operation>> operations;
+            std::vector<PreparedParametersPtr> prepared;
+            for (const auto& op_config : config.operations) {
+                operations.push_back(OperationFactory::createOperation(op_config.type));
+                if (!operations.back()) {
+                    std::cerr << "error: could not create operation of type '" << op_config.type << "'" << std::endl;
+                    return -1;
+                }
+                prepared.push_back(operations.back()->prepare(op_config.parameters));
+            }
+            
+            // determine roi to use per step, then walk backwards to find the region of
+            // each step's result that later steps actually read (the last one is saved whole)
+            std::vector<ROI> rois;
+            for (const auto& op_config : config.operations) {
+                rois.push_back(op_config.roi.full_image ? config.global_roi : op_config.roi);
+            }
+            
+            std::vector<ROI> required(config.operations.size(), ROI(0, 0, 0, 0, true));
+            for (size_t i = config.operations.size(); i-- > 1;) {
+                required[i - 1] = operations[i]->getRequiredRegion(required[i], rois[i], config.operations[i].parameters);
+            }
+            
             // execute operations
             for (size_t i = 0; i < config.operations.size(); ++i) {
                 const auto& op_config = config.operations[i];
                 
                 std::cout << "  step " << (i + 1) << ": " << op_config.type << std::endl;
                 
-                // create operation using factory
-                auto operation = OperationFactory::createOperation(op_config.type);
-                if (!operation) {
-                    std::cerr << "error: could not create operation of type '" << op_config.type << "'" << std::endl;
-                    return -1;
+                // execute operation (result is owned only by this loop, so it can be reused);
+                // local operations only compute the part of their result that is read later
+                if (operations[i]->isLocal() && !required[i].full_image) {
+                    ROI region = ROITools::clip(required[i], result.size());
+                    if (ROITools::isEmpty(ROITools::clip(ROITools::intersect(rois[i], region), result.size()))) {
+                        std::cout << "operation " << (i + 1) << " skipped (result not needed)" << std::endl;
+                        continue;
+                    }
+                    result = operations[i]->runRegion(result, rois[i], region, *prepared[i]);
+                } else {
+                    result = operations[i]->runInPlace(result, rois[i], *prepared[i]);
                 }
                 
-                // determine roi to use
-                ROI roi_to_use = (op_config.roi.full_image) 
-                               ? config.global_roi 
-                               : op_config.roi;
-                
-                // execute operation
-                result = operation->execute(result, roi_to_use, op_config.parameters);
+                // a failed check: every later step reads its result, so the frame is rejected
+                if (result.empty()) {
+                    std::cout << "frame rejected by step " << (i + 1) << ": " << op_config.type << std::endl;
+                    return 0;
+                }
                 
                 std::cout << "operation " << (i + 1) << " completed successfully!!" << std::endl;
             }
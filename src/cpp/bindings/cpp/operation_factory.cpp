@@ -8,7 +8,9 @@ const std::map<std::string, OperationFactory::OperationCreator> OperationFactory
     {"sharpen", &OperationFactory::createSharpen},
     {"contrast", &OperationFactory::createContrast},
     {"edge_count", &OperationFactory::createEdgeCount},
-    {"blur_detection", &OperationFactory::createBlurDetection}
+    {"blur_detection", &OperationFactory::createBlurDetection},
+    {"blur_check", &OperationFactory::createBlurCheck},
+    {"edge_check", &OperationFactory::createEdgeCheck}
 };
 
 std::unique_ptr<Operation> OperationFactory::createOperation(const std::string& type) {
@@ -45,4 +47,12 @@ std::unique_ptr<Operation> OperationFactory::createEdgeCount() {
 
 std::unique_ptr<Operation> OperationFactory::createBlurDetection() {
     return std::make_unique<BlurDetectionOperation>();
-}
\ No newline at end of file
+}
+
+std::unique_ptr<Operation> OperationFactory::createBlurCheck() {
+    return std::make_unique<BlurCheckOperation>();
+}
+
+std::unique_ptr<Operation> OperationFactory::createEdgeCheck() {
+    return std::make_unique<EdgeCheckOperation>();
+}
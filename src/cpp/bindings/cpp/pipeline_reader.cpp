@@ -272,6 +272,11 @@ NodeConfig PipelineReader::parseNode(const json& node_json) {
         node.image_path = node_json["image_path"];
     }
     
+    // parse optional flag (nodes a frame can do without, e.g. diagnostic statistics)
+    if (node_json.contains("optional") && node_json["optional"].is_boolean()) {
+        node.optional = node_json["optional"];
+    }
+    
     return node;
 }
 
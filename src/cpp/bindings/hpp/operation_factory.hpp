@@ -23,4 +23,6 @@ private:
     static std::unique_ptr<Operation> createContrast();
     static std::unique_ptr<Operation> createEdgeCount();
     static std::unique_ptr<Operation> createBlurDetection();
+    static std::unique_ptr<Operation> createBlurCheck();
+    static std::unique_ptr<Operation> createEdgeCheck();
 }; 
\ No newline at end of file
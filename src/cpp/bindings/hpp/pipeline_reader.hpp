@@ -39,6 +39,7 @@ struct NodeConfig {
     std::vector<std::string> inputs;
     ROI roi;
     std::string image_path;  // for input/output nodes
+    bool optional = false;   // may be skipped when a frame runs out of time
 };
 
 /**
@@ -0,0 +1,219 @@
+#include "buffer_pool.hpp"
+#include <new>
+
+namespace {
+    // active guards and the allocator they replaced (guards may overlap across threads)
+    std::mutex scope_mutex;
+    int active_scopes = 0;
+    std::atomic<cv::MatAllocator*> previous_allocator{nullptr};
+
+    // guards alive on this thread
+    thread_local int thread_scopes = 0;
+}
+
+// constructor
+BufferPool::BufferPool()
+    : cached_bytes_(0), capacity_(size_t(512) << 20), fresh_allocations_(0), reused_allocations_(0) {}
+
+// process-wide pool
+BufferPool& BufferPool::instance() {
+    // intentionally leaked: buffers handed out may be released after static destruction
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+// allocate a buffer, reusing a freed one of the same byte size when possible
+cv::UMatData* BufferPool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                                   cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const {
+    // threads outside a pooled scope allocate as if the pool was not installed
+    if (thread_scopes == 0) {
+        cv::MatAllocator* previous = previous_allocator.load();
+        if (!previous) {
+            previous = cv::Mat::getStdAllocator();
+        }
+        return previous->allocate(dims, sizes, type, data0, step, flags, usage_flags);
+    }
+
+    // same layout computation as opencv's standard allocator
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != cv::Mat::AUTO_STEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    // wrapping user memory, nothing to pool
+    if (data0) {
+        cv::UMatData* u = new cv::UMatData(this);
+        u->data = u->origdata = static_cast<uchar*>(data0);
+        u->size = total;
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+        return u;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = free_buffers_.find(total);
+        if (it != free_buffers_.end()) {
+            cv::UMatData* u = it->second.buffers.back();
+            it->second.buffers.pop_back();
+            cached_bytes_ -= total;
+            reused_allocations_++;
+
+            // a size in use is the last one to evict
+            if (it->second.buffers.empty()) {
+                lru_.erase(it->second.recency);
+                free_buffers_.erase(it);
+            } else {
+                lru_.splice(lru_.begin(), lru_, it->second.recency);
+            }
+
+            // reset the recycled header in place, keeping its buffer
+            uchar* buffer = u->origdata;
+            u->~UMatData();
+            new (u) cv::UMatData(this);
+            u->data = u->origdata = buffer;
+            u->size = total;
+            return u;
+        }
+    }
+
+    fresh_allocations_++;
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = static_cast<uchar*>(cv::fastMalloc(total));
+    u->size = total;
+    return u;
+}
+
+// nothing to do for host memory
+bool BufferPool::allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const {
+    (void)access_flags;
+    (void)usage_flags;
+    return data != nullptr;
+}
+
+// return a buffer to the pool
+void BufferPool::deallocate(cv::UMatData* u) const {
+    if (!u) {
+        return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+
+    if (u->flags & cv::UMatData::USER_ALLOCATED) {
+        delete u;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = free_buffers_.find(u->size);
+    if (it == free_buffers_.end()) {
+        lru_.push_front(u->size);
+        it = free_buffers_.emplace(u->size, SizeClass{{}, lru_.begin()}).first;
+    } else {
+        lru_.splice(lru_.begin(), lru_, it->second.recency);
+    }
+    it->second.buffers.push_back(u);
+    cached_bytes_ += u->size;
+    evict();
+}
+
+// free cached buffers of the least recently used sizes (mutex_ is held)
+void BufferPool::evict() const {
+    while (cached_bytes_ > capacity_ && !lru_.empty()) {
+        auto it = free_buffers_.find(lru_.back());
+        destroy(it->second.buffers.back());
+        it->second.buffers.pop_back();
+        cached_bytes_ -= it->first;
+        if (it->second.buffers.empty()) {
+            lru_.pop_back();
+            free_buffers_.erase(it);
+        }
+    }
+}
+
+// free a cached buffer and its header
+void BufferPool::destroy(cv::UMatData* u) {
+    cv::fastFree(u->origdata);
+    u->origdata = u->data = nullptr;
+    delete u;
+}
+
+// bytes currently cached for reuse
+size_t BufferPool::getCachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+}
+
+// most bytes kept for reuse
+size_t BufferPool::getCapacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+// change the most bytes kept for reuse, evicting what no longer fits
+void BufferPool::setCapacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = bytes;
+    evict();
+}
+
+// free every cached buffer
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& pair : free_buffers_) {
+        for (cv::UMatData* u : pair.second.buffers) {
+            destroy(u);
+        }
+    }
+    free_buffers_.clear();
+    lru_.clear();
+    cached_bytes_ = 0;
+}
+
+// whether the calling thread allocates through the pool
+bool BufferPool::isThreadPooled() {
+    return thread_scopes > 0;
+}
+
+// install the pool as default allocator (the first active guard does the switch)
+ScopedBufferPool::ScopedBufferPool() {
+    {
+        std::lock_guard<std::mutex> lock(scope_mutex);
+        if (active_scopes++ == 0) {
+            previous_allocator.store(cv::Mat::getDefaultAllocator());
+            cv::Mat::setDefaultAllocator(&BufferPool::instance());
+        }
+    }
+    ++thread_scopes;
+}
+
+// restore the previous default allocator (the last active guard does the switch)
+ScopedBufferPool::~ScopedBufferPool() {
+    --thread_scopes;
+    std::lock_guard<std::mutex> lock(scope_mutex);
+    if (--active_scopes == 0) {
+        cv::Mat::setDefaultAllocator(previous_allocator.load());
+    }
+}
+
+// mark the calling thread as pooled
+BufferPoolThreadScope::BufferPoolThreadScope(bool enabled) : enabled_(enabled) {
+    if (enabled_) {
+        ++thread_scopes;
+    }
+}
+
+// unmark the calling thread
+BufferPoolThreadScope::~BufferPoolThreadScope() {
+    if (enabled_) {
+        --thread_scopes;
+    }
+}
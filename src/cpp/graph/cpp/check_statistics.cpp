@@ -0,0 +1,46 @@
+#include "check_statistics.hpp"
+#include <algorithm>
+#include <limits>
+
+// constructor
+CheckStatistics::CheckStatistics(size_t window)
+    : costs_(std::max<size_t>(window, 1), 0.0), failures_(std::max<size_t>(window, 1), false),
+      next_(0), count_(0), cost_sum_(0.0), failure_count_(0) {
+}
+
+// record one run of the check, replacing the oldest once the window is full
+void CheckStatistics::record(double cost_ms, bool failed) {
+    if (count_ == costs_.size()) {
+        cost_sum_ -= costs_[next_];
+        failure_count_ -= failures_[next_] ? 1 : 0;
+    } else {
+        ++count_;
+    }
+
+    costs_[next_] = cost_ms;
+    failures_[next_] = failed;
+    cost_sum_ += cost_ms;
+    failure_count_ += failed ? 1 : 0;
+    next_ = (next_ + 1) % costs_.size();
+}
+
+// average run time in milliseconds
+double CheckStatistics::getMeanCost() const {
+    return count_ > 0 ? std::max(cost_sum_, 0.0) / count_ : 0.0;
+}
+
+// fraction of runs that rejected the frame
+double CheckStatistics::getRejectRate() const {
+    return count_ > 0 ? static_cast<double>(failure_count_) / count_ : 0.0;
+}
+
+// expected time spent per rejected frame
+double CheckStatistics::getRank() const {
+    if (count_ == 0) {
+        return 0.0;
+    }
+    if (failure_count_ == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return getMeanCost() / getRejectRate();
+}
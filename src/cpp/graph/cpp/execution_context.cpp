@@ -0,0 +1,46 @@
+#include "execution_context.hpp"
+
+// constructor
+ExecutionContext::ExecutionContext()
+    : plan_version_(0), result_slot_(static_cast<size_t>(-1)), has_priorities_(false), inputs_resolved_(false), capture_outputs_(false),
+      deadline_(std::chrono::steady_clock::time_point::max()), time_budget_(0),
+      run_deadline_(std::chrono::steady_clock::time_point::max()), measure_costs_(false), remaining_required_us_(0), geometry_changed_(false),
+      resident_bytes_(0), peak_resident_bytes_(0), started_nodes_(0), executed_nodes_(0),
+      cache_hits_(0), cache_misses_(0), reused_nodes_(0), skipped_nodes_(0), rejected_(false), shed_nodes_(0) {
+}
+
+// run an input node on an injected image
+void ExecutionContext::setInput(const NodeId& input_id, const cv::Mat& image) {
+    // a new input node is resolved to its slot on the next run
+    auto inserted = inputs_.try_emplace(input_id);
+    inputs_resolved_ = inputs_resolved_ && !inserted.second;
+    InjectedInput& input = inserted.first->second;
+    input.image = image;
+    input.changed = true;
+}
+
+// run everything regardless of time
+void ExecutionContext::clearDeadline() {
+    deadline_ = std::chrono::steady_clock::time_point::max();
+    time_budget_ = std::chrono::milliseconds(0);
+}
+
+// get the final result of the last run
+cv::Mat ExecutionContext::getResult() const {
+    if (rejected_.load() || result_slot_ >= node_results_.size()) {
+        return cv::Mat();
+    }
+    return node_results_[result_slot_];
+}
+
+// drop every result slot
+void ExecutionContext::clearResults() {
+    for (auto& result : node_results_) {
+        result.release();
+    }
+    for (auto& released : released_) {
+        released.store(0, std::memory_order_relaxed);
+    }
+    buffer_refs_.clear();
+    resident_bytes_ = 0;
+}
@@ -0,0 +1,213 @@
+#include "execution_plan.hpp"
+#include "fused_pointwise_node.hpp"
+#include "result_cache.hpp"
+#include "tiled_chain_node.hpp"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+namespace {
+    // node whose result is returned: first output node by id, otherwise the largest id
+    NodeId resultNodeId(const Graph& graph, const ExecutionLevels& levels) {
+        auto output_nodes = graph.getNodesByType("output");
+        if (!output_nodes.empty()) {
+            return output_nodes[0];
+        }
+
+        NodeId result_id;
+        for (const auto& level : levels) {
+            for (const auto& node_id : level) {
+                result_id = std::max(result_id, node_id);
+            }
+        }
+        return result_id;
+    }
+
+    // longest chain starting at head where every link is the only connection between
+    // two nodes, no intermediate result is read by anyone else and can_join accepts
+    // each node (previous is null for the head)
+    std::vector<GraphNode*> linearChain(Graph& graph, const NodeId& head, const NodeId& result_id,
+                                        const std::function<bool(const GraphNode*, const GraphNode*)>& can_join) {
+        std::vector<GraphNode*> chain;
+        GraphNode* current = graph.getNode(head);
+        if (!can_join(current, nullptr)) {
+            return chain;
+        }
+        chain.push_back(current);
+
+        while (current->getId() != result_id) {
+            auto outgoing = graph.getOutgoingConnections(current->getId());
+            if (outgoing.size() != 1) {
+                break;
+            }
+
+            GraphNode* next = graph.getNode(outgoing[0].to_node);
+            if (graph.getIncomingConnections(next->getId()).size() != 1 || !can_join(next, current)) {
+                break;
+            }
+
+            chain.push_back(next);
+            current = next;
+        }
+        return chain;
+    }
+
+    // pointwise nodes sharing one roi
+    bool joinsPointwiseChain(const GraphNode* node, const GraphNode* previous) {
+        return node->isPointwise() && (!previous || ROITools::isSame(node->getROI(), previous->getROI()));
+    }
+
+    // nodes that can run tile by tile
+    bool joinsTiledChain(const GraphNode* node, const GraphNode* previous) {
+        (void)previous;
+        return TiledChainNode::canTile(node);
+    }
+}
+
+// compile a validated, acyclic graph into a plan
+ExecutionPlan ExecutionPlan::compile(Graph& graph, const CompileOptions& options) {
+    ExecutionPlan plan;
+
+    const ExecutionLevels& levels = graph.getExecutionLevels();
+    if (levels.empty() && !graph.isEmpty()) {
+        throw std::runtime_error("Graph has no valid execution order (possibly cyclic)");
+    }
+
+    // assign dense indices in topological order (the only string lookups left);
+    // every member of a fused chain maps to the fused node, which takes the place
+    // of the chain head and reads the head's inputs
+    std::map<NodeId, size_t> node_index;
+    std::vector<NodeId> head_ids;   // per plan index, the graph node whose inputs it reads
+    std::set<NodeId> fused_members;
+    NodeId result_id = resultNodeId(graph, levels);
+    for (const auto& level : levels) {
+        std::vector<size_t> level_indices;
+        level_indices.reserve(level.size());
+        for (const auto& node_id : level) {
+            if (fused_members.count(node_id)) {
+                continue;
+            }
+
+            size_t index = plan.nodes.size();
+            level_indices.push_back(index);
+            node_index[node_id] = index;
+            head_ids.push_back(node_id);
+
+            // tiling takes precedence, a tiled chain fuses its pointwise runs itself
+            std::vector<GraphNode*> chain;
+            std::shared_ptr<GraphNode> fused;
+            if (options.tile_size > 0) {
+                chain = linearChain(graph, node_id, result_id, joinsTiledChain);
+                if (chain.size() > 1) {
+                    fused = std::make_shared<TiledChainNode>(chain, options.tile_size, options.thread_pool,
+                                                             options.fuse_pointwise);
+                }
+            }
+            if (!fused && options.fuse_pointwise) {
+                chain = linearChain(graph, node_id, result_id, joinsPointwiseChain);
+                if (chain.size() > 1) {
+                    fused = std::make_shared<FusedPointwiseNode>(chain);
+                }
+            }
+
+            if (fused) {
+                // the chain can only be shed as a whole
+                fused->setOptional(std::all_of(chain.begin(), chain.end(),
+                                               [](const GraphNode* member) { return member->isOptional(); }));
+                for (const auto* member : chain) {
+                    node_index[member->getId()] = index;
+                    fused_members.insert(member->getId());
+                }
+                plan.nodes.push_back(fused.get());
+                plan.members.push_back(chain);
+                plan.fused_nodes.push_back(std::move(fused));
+            } else {
+                plan.nodes.push_back(graph.getNode(node_id));
+                plan.members.push_back({plan.nodes.back()});
+            }
+        }
+        if (!level_indices.empty()) {
+            plan.levels.push_back(std::move(level_indices));
+        }
+    }
+
+    size_t node_count = plan.nodes.size();
+    plan.input_slots.resize(node_count);
+    plan.producers.resize(node_count);
+    plan.consumers.resize(node_count);
+
+    // resolve connections into input slot lists
+    for (size_t i = 0; i < node_count; ++i) {
+        for (const auto& connection : graph.getIncomingConnections(head_ids[i])) {
+            auto it = node_index.find(connection.from_node);
+            if (it == node_index.end()) {
+                throw std::runtime_error("Connection from unknown node: " + connection.from_node);
+            }
+            plan.input_slots[i].push_back(it->second);
+        }
+
+        // a producer feeding several ports still counts once
+        std::vector<size_t>& producers = plan.producers[i];
+        producers = plan.input_slots[i];
+        std::sort(producers.begin(), producers.end());
+        producers.erase(std::unique(producers.begin(), producers.end()), producers.end());
+        for (size_t producer : producers) {
+            plan.consumers[producer].push_back(i);
+        }
+    }
+
+    // final result: first output node by id, otherwise the node with the largest id
+    if (!node_index.empty()) {
+        plan.result_slot = node_index.at(result_id);
+    }
+    
+    // per node properties runs would otherwise look up by string
+    plan.is_output.assign(node_count, false);
+    plan.rejects_frame.assign(node_count, false);
+    for (size_t i = 0; i < node_count; ++i) {
+        plan.is_output[i] = plan.nodes[i]->getType() == "output";
+        plan.rejects_frame[i] = plan.nodes[i]->rejectsFrame();
+        if (plan.input_slots[i].empty()) {
+            plan.sources[plan.nodes[i]->getId()] = i;
+        }
+    }
+    
+    // a node may take over its input buffer if nobody else will ever read that slot
+    plan.sole_consumer.assign(node_count, false);
+    for (size_t i = 0; i < node_count; ++i) {
+        if (plan.input_slots[i].size() == 1) {
+            size_t producer = plan.input_slots[i][0];
+            plan.sole_consumer[i] = plan.consumers[producer].size() == 1 && producer != plan.result_slot;
+        }
+    }
+
+    // demand-driven regions: walking backwards, every node asks its producers for the
+    // input region it reads to produce what its own consumers read (the result is
+    // needed whole, a node nobody reads needs nothing)
+    plan.required_regions.assign(node_count, ROI(0, 0, 0, 0, true));
+    if (options.propagate_regions && node_count > 0) {
+        std::vector<ROI> demand(node_count, ROI());
+        demand[plan.result_slot] = ROI(0, 0, 0, 0, true);
+        for (size_t i = node_count; i-- > 0;) {
+            ROI needed = plan.nodes[i]->getRequiredRegion(demand[i]);
+            for (size_t producer : plan.producers[i]) {
+                demand[producer] = ROITools::unite(demand[producer], needed);
+            }
+        }
+        plan.required_regions = std::move(demand);
+    }
+    
+    // what each node computes, hashed once per plan instead of once per cached run
+    plan.signature_keys.assign(node_count, 0);
+    for (size_t i = 0; i < node_count; ++i) {
+        std::string signature = plan.nodes[i]->getSignature();
+        const ROI& region = plan.required_regions[i];
+        int region_fields[5] = {region.x, region.y, region.width, region.height, region.full_image ? 1 : 0};
+        plan.signature_keys[i] = ResultCache::combine(ResultCache::hashBytes(signature.data(), signature.size()),
+                                                      ResultCache::hashBytes(region_fields, sizeof(region_fields)));
+    }
+
+    return plan;
+}
@@ -0,0 +1,76 @@
+#include "fused_pointwise_node.hpp"
+#include <stdexcept>
+
+// constructor
+FusedPointwiseNode::FusedPointwiseNode(const std::vector<GraphNode*>& stages)
+    : GraphNode(joinNodeIds(stages), "fused_pointwise"), stages_(stages) {
+    if (stages_.empty()) {
+        throw std::runtime_error("fused pointwise node needs at least one stage");
+    }
+    setROI(stages_.front()->getROI());
+
+    // compose the table by running the real stages over every 8-bit value, so the
+    // fused result is bit-exact with unfused execution
+    cv::Mat ramp(1, 256, CV_8U);
+    for (int value = 0; value < 256; ++value) {
+        ramp.at<uchar>(0, value) = static_cast<uchar>(value);
+    }
+    lut_ = executeStages(ramp);
+
+    if (lut_.type() != CV_8U || lut_.total() != 256) {
+        throw std::runtime_error("fused stages do not map 8-bit values to 8-bit values: " + getId());
+    }
+}
+
+// the signatures of the fused stages
+std::string FusedPointwiseNode::getSignature() const {
+    std::string signature;
+    for (const auto* stage : stages_) {
+        signature += stage->getSignature() + ">";
+    }
+    return signature;
+}
+
+// run the stages one after another
+cv::Mat FusedPointwiseNode::executeStages(const cv::Mat& input) const {
+    cv::Mat result = input;
+    for (auto* stage : stages_) {
+        result = stage->execute(std::vector<cv::Mat>{result}, ROI(0, 0, 0, 0, true), stage->getParameters());
+    }
+    return result;
+}
+
+// execute method - applies the whole chain
+cv::Mat FusedPointwiseNode::execute(const std::vector<cv::Mat>& inputs, 
+                                    const ROI& roi, 
+                                    const std::map<std::string, double>& parameters) {
+    (void)parameters;
+
+    if (inputs.size() != 1) {
+        throw std::runtime_error("fused pointwise node requires exactly one input image");
+    }
+
+    cv::Mat roi_image = ROITools::extractROI(inputs[0], roi);
+    cv::Mat output;
+    if (roi_image.depth() == CV_8U) {
+        // one pass: the same table serves every channel
+        cv::LUT(roi_image, lut_, output);
+    } else {
+        output = executeStages(roi_image);
+    }
+
+    return ROITools::applyROI(inputs[0], output, roi);
+}
+
+// execute method - applies the whole chain inside the input buffer
+cv::Mat FusedPointwiseNode::executeInPlace(cv::Mat& input, 
+                                           const ROI& roi, 
+                                           const std::map<std::string, double>& parameters) {
+    if (input.depth() != CV_8U) {
+        return execute(std::vector<cv::Mat>{input}, roi, parameters);
+    }
+
+    cv::Mat roi_image = ROITools::extractROI(input, roi);
+    cv::LUT(roi_image, lut_, roi_image);
+    return input;
+}
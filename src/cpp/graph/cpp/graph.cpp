@@ -4,15 +4,34 @@
 #include <unordered_set>
 #include <iostream>
 
+namespace {
+    // key of a linked node pair in linked_pairs_
+    std::string pairKey(const NodeId& from_node_id, const NodeId& to_node_id) {
+        std::string key;
+        key.reserve(from_node_id.size() + to_node_id.size() + 1);
+        key.append(from_node_id).push_back('\0');
+        key.append(to_node_id);
+        return key;
+    }
+}
+
 // constructor
-Graph::Graph() {}
+Graph::Graph() : levels_dirty_(false), levels_stale_(false), update_depth_(0) {}
 
 // add a node to the graph
 void Graph::addNode(NodePtr node) {
     if (node) {
-        nodes_[node->getId()] = std::move(node);
-        // update execution levels after adding a node
-        updateExecutionLevels();
+        NodeId node_id = node->getId();
+        bool replaced = nodes_.find(node_id) != nodes_.end();
+        nodes_[node_id] = std::move(node);
+        
+        if (replaced || update_depth_ > 0) {
+            levels_dirty_ = true;
+        } else if (!levels_dirty_) {
+            // a new node has no edges yet, so it starts in the first level
+            node_depths_[node_id] = 0;
+            levels_stale_ = true;
+        }
     }
 }
 
@@ -56,11 +75,27 @@ bool Graph::removeNode(const NodeId& node_id) {
             }
         }
         
+        // forget the linked pairs of this node
+        for (const auto& input_id : node->getInputNodeIds()) {
+            linked_pairs_.erase(pairKey(input_id, node_id));
+        }
+        for (const auto& output_id : node->getOutputNodeIds()) {
+            linked_pairs_.erase(pairKey(node_id, output_id));
+        }
+        
+        // drop port connections that reference the node
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                          [&node_id](const Connection& conn) {
+                                              return conn.from_node == node_id || conn.to_node == node_id;
+                                          }),
+                           connections_.end());
+        rebuildConnectionIndex();
+        
         // remove the node
         nodes_.erase(it);
         
-        // update execution levels after removing a node
-        updateExecutionLevels();
+        // depths of the former consumers may shrink, so sort again on next use
+        levels_dirty_ = true;
         return true;
     }
     return false;
@@ -71,11 +106,8 @@ void Graph::connectNodes(const NodeId& from_node_id, const NodeId& to_node_id) {
     GraphNode* from_node = getNode(from_node_id);
     GraphNode* to_node = getNode(to_node_id);
     
-    if (from_node && to_node) {
-        from_node->addOutput(to_node_id);
-        to_node->addInput(from_node_id);
-        // update execution levels after connecting nodes
-        updateExecutionLevels();
+    if (from_node && to_node && linkNodes(from_node, to_node)) {
+        propagateDepth(from_node_id, to_node_id);
     }
 }
 
@@ -87,8 +119,18 @@ void Graph::disconnectNodes(const NodeId& from_node_id, const NodeId& to_node_id
     if (from_node && to_node) {
         from_node->removeOutput(to_node_id);
         to_node->removeInput(from_node_id);
-        // update execution levels after disconnecting nodes
-        updateExecutionLevels();
+        linked_pairs_.erase(pairKey(from_node_id, to_node_id));
+        
+        // drop port connections between the two nodes
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                          [&](const Connection& conn) {
+                                              return conn.from_node == from_node_id && conn.to_node == to_node_id;
+                                          }),
+                           connections_.end());
+        rebuildConnectionIndex();
+        
+        // depths may shrink, so sort again on next use
+        levels_dirty_ = true;
     }
 }
 
@@ -185,7 +227,8 @@ ExecutionLevels Graph::topologicalSort() const {
     ExecutionLevels levels;
     
     // calculate in-degrees for each node
-    std::map<NodeId, int> in_degree;
+    std::unordered_map<NodeId, int> in_degree;
+    in_degree.reserve(nodes_.size());
     for (const auto& pair : nodes_) {
         in_degree[pair.first] = 0;
     }
@@ -200,9 +243,9 @@ ExecutionLevels Graph::topologicalSort() const {
     // kahn's algorithm for topological sorting
     std::queue<NodeId> queue;
     
-    // add nodes with in-degree 0 to queue
-    for (const auto& pair : in_degree) {
-        if (pair.second == 0) {
+    // add nodes with in-degree 0 to queue (in id order, for a stable level layout)
+    for (const auto& pair : nodes_) {
+        if (in_degree[pair.first] == 0) {
             queue.push(pair.first);
         }
     }
@@ -247,27 +290,141 @@ ExecutionLevels Graph::topologicalSort() const {
     return levels;
 }
 
-// update execution levels (call after graph changes)
+// get execution levels (cached result of topological sort, refreshed if needed)
+const ExecutionLevels& Graph::getExecutionLevels() const {
+    refreshExecutionLevels();
+    return execution_levels_;
+}
+
+// force a full recomputation of the execution levels
 void Graph::updateExecutionLevels() {
-    execution_levels_ = topologicalSort();
+    levels_dirty_ = true;
+    refreshExecutionLevels();
+}
+
+// start a batch of edits
+void Graph::beginUpdate() {
+    ++update_depth_;
+}
+
+// finish a batch of edits
+void Graph::endUpdate() {
+    if (update_depth_ > 0) {
+        --update_depth_;
+    }
+}
+
+// bring execution levels up to date
+void Graph::refreshExecutionLevels() const {
+    if (levels_dirty_) {
+        // full kahn sort, O(N + E)
+        ExecutionLevels sorted = topologicalSort();
+        node_depths_.clear();
+        node_depths_.reserve(nodes_.size());
+        for (size_t level = 0; level < sorted.size(); ++level) {
+            for (const auto& node_id : sorted[level]) {
+                node_depths_[node_id] = level;
+            }
+        }
+        
+        // a cyclic graph keeps sorting until an edit fixes it
+        levels_dirty_ = sorted.empty() && !nodes_.empty();
+        if (levels_dirty_) {
+            execution_levels_.clear();
+            levels_stale_ = false;
+            return;
+        }
+        levels_stale_ = true;
+    }
+    
+    if (levels_stale_) {
+        // depths are valid, regroup the nodes into levels in id order, O(N)
+        size_t level_count = 0;
+        for (const auto& pair : node_depths_) {
+            level_count = std::max(level_count, pair.second + 1);
+        }
+        
+        execution_levels_.assign(level_count, ExecutionLevel());
+        for (const auto& pair : nodes_) {
+            execution_levels_[node_depths_.at(pair.first)].push_back(pair.first);
+        }
+        levels_stale_ = false;
+    }
+}
+
+// link two existing nodes, returns false if they were already linked
+bool Graph::linkNodes(GraphNode* from_node, GraphNode* to_node) {
+    if (!linked_pairs_.insert(pairKey(from_node->getId(), to_node->getId())).second) {
+        return false;
+    }
+    from_node->appendOutput(to_node->getId());
+    to_node->appendInput(from_node->getId());
+    return true;
+}
+
+// raise depths after the edge from -> to was added
+void Graph::propagateDepth(const NodeId& from_node_id, const NodeId& to_node_id) {
+    // inside a batch, or with a full sort pending anyway, just mark dirty
+    if (update_depth_ > 0 || levels_dirty_) {
+        levels_dirty_ = true;
+        return;
+    }
+    
+    size_t from_depth = node_depths_.at(from_node_id);
+    if (node_depths_.at(to_node_id) > from_depth) {
+        return; // level layout is unaffected
+    }
+    
+    // push the new depth forward through the consumers that are now too shallow
+    node_depths_[to_node_id] = from_depth + 1;
+    std::vector<NodeId> pending{to_node_id};
+    while (!pending.empty()) {
+        NodeId current_id = pending.back();
+        pending.pop_back();
+        size_t next_depth = node_depths_.at(current_id) + 1;
+        
+        for (const auto& output_id : getNode(current_id)->getOutputNodeIds()) {
+            if (output_id == from_node_id) {
+                // the new edge closed a cycle, let the full sort report it
+                levels_dirty_ = true;
+                return;
+            }
+            
+            size_t& output_depth = node_depths_.at(output_id);
+            if (output_depth < next_depth) {
+                output_depth = next_depth;
+                pending.push_back(output_id);
+            }
+        }
+    }
+    
+    levels_stale_ = true;
+}
+
+// rebuild the connection indices after connections were removed
+void Graph::rebuildConnectionIndex() {
+    incoming_index_.clear();
+    outgoing_index_.clear();
+    for (size_t i = 0; i < connections_.size(); ++i) {
+        incoming_index_[connections_[i].to_node].push_back(i);
+        outgoing_index_[connections_[i].from_node].push_back(i);
+    }
 }
 
 // add connection with ports
 void Graph::addConnection(const NodeId& from_node, int from_port, 
                          const NodeId& to_node, int to_port) {
+    incoming_index_[to_node].push_back(connections_.size());
+    outgoing_index_[from_node].push_back(connections_.size());
     connections_.emplace_back(from_node, from_port, to_node, to_port);
     
     // also update node connections for backward compatibility
     GraphNode* from_node_ptr = getNode(from_node);
     GraphNode* to_node_ptr = getNode(to_node);
     
-    if (from_node_ptr && to_node_ptr) {
-        from_node_ptr->addOutput(to_node);
-        to_node_ptr->addInput(from_node);
+    if (from_node_ptr && to_node_ptr && linkNodes(from_node_ptr, to_node_ptr)) {
+        propagateDepth(from_node, to_node);
     }
-    
-    // update execution levels after adding connection
-    updateExecutionLevels();
 }
 
 // get all nodes (returns raw pointers to avoid unique_ptr copying issues)
@@ -294,9 +451,11 @@ std::vector<NodeId> Graph::getNodesByType(const std::string& type) const {
 // get incoming connections for a node
 std::vector<Connection> Graph::getIncomingConnections(const NodeId& node_id) const {
     std::vector<Connection> incoming;
-    for (const auto& conn : connections_) {
-        if (conn.to_node == node_id) {
-            incoming.push_back(conn);
+    auto it = incoming_index_.find(node_id);
+    if (it != incoming_index_.end()) {
+        incoming.reserve(it->second.size());
+        for (size_t index : it->second) {
+            incoming.push_back(connections_[index]);
         }
     }
     return incoming;
@@ -305,9 +464,11 @@ std::vector<Connection> Graph::getIncomingConnections(const NodeId& node_id) con
 // get outgoing connections for a node
 std::vector<Connection> Graph::getOutgoingConnections(const NodeId& node_id) const {
     std::vector<Connection> outgoing;
-    for (const auto& conn : connections_) {
-        if (conn.from_node == node_id) {
-            outgoing.push_back(conn);
+    auto it = outgoing_index_.find(node_id);
+    if (it != outgoing_index_.end()) {
+        outgoing.reserve(it->second.size());
+        for (size_t index : it->second) {
+            outgoing.push_back(connections_[index]);
         }
     }
     return outgoing;
@@ -316,7 +477,8 @@ std::vector<Connection> Graph::getOutgoingConnections(const NodeId& node_id) con
 // get topological order for execution
 std::vector<NodeId> Graph::getTopologicalOrder() const {
     std::vector<NodeId> order;
-    auto levels = topologicalSort();
+    order.reserve(nodes_.size());
+    const auto& levels = getExecutionLevels();
     
     for (const auto& level : levels) {
         for (const auto& node_id : level) {
@@ -331,7 +493,13 @@ std::vector<NodeId> Graph::getTopologicalOrder() const {
 void Graph::clear() {
     nodes_.clear();
     connections_.clear();
+    incoming_index_.clear();
+    outgoing_index_.clear();
+    linked_pairs_.clear();
     input_node_id_.clear();
     output_node_id_.clear();
     execution_levels_.clear();
+    node_depths_.clear();
+    levels_dirty_ = false;
+    levels_stale_ = false;
 } 
\ No newline at end of file
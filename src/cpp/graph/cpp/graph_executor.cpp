@@ -1,12 +1,117 @@
 #include "graph_executor.hpp"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <thread>
 #include <stdexcept>
 
-GraphExecutor::GraphExecutor() {
-    stats_.total_nodes = 0;
-    stats_.executed_nodes = 0;
-    stats_.execution_time = std::chrono::milliseconds(0);
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    // weight of the newest measurement in a node's smoothed cost
+    const double cost_smoothing = 0.25;
+    
+    // split costs into count contiguous, non-empty ranges so the most expensive range is as
+    // cheap as possible; returns the first index of each range
+    std::vector<size_t> partitionByCost(const std::vector<double>& costs, size_t count) {
+        size_t n = costs.size();
+        std::vector<double> prefix(n + 1, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            prefix[i + 1] = prefix[i] + costs[i];
+        }
+        
+        // best[k][j]: cheapest bottleneck of the first j costs in k + 1 ranges, cut[k][j]: where
+        // the last of those ranges begins
+        const double unreachable = std::numeric_limits<double>::infinity();
+        std::vector<std::vector<double>> best(count, std::vector<double>(n + 1, unreachable));
+        std::vector<std::vector<size_t>> cut(count, std::vector<size_t>(n + 1, 0));
+        for (size_t j = 1; j <= n; ++j) {
+            best[0][j] = prefix[j];
+        }
+        for (size_t k = 1; k < count; ++k) {
+            for (size_t j = k + 1; j <= n; ++j) {
+                for (size_t i = k; i < j; ++i) {
+                    double bottleneck = std::max(best[k - 1][i], prefix[j] - prefix[i]);
+                    if (bottleneck < best[k][j]) {
+                        best[k][j] = bottleneck;
+                        cut[k][j] = i;
+                    }
+                }
+            }
+        }
+        
+        std::vector<size_t> begin(count, 0);
+        size_t end = n;
+        for (size_t k = count; k-- > 1;) {
+            begin[k] = cut[k][end];
+            end = begin[k];
+        }
+        return begin;
+    }
+    
+    // keep a thread on one core (best effort; other platforms leave scheduling to the os)
+    void pinThread(std::thread& thread, size_t index) {
+#ifdef __linux__
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % cores, &cpus);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpus);
+#else
+        (void)thread;
+        (void)index;
+#endif
+    }
+    
+    // one run at a time may let output nodes save their files: concurrent runs would
+    // write the same paths
+    class OutputFileLease {
+    private:
+        std::atomic<int>& writers_;
+        
+    public:
+        explicit OutputFileLease(std::atomic<int>& writers) : writers_(writers) {
+            if (writers_.fetch_add(1) > 0) {
+                writers_.fetch_sub(1);
+                throw std::runtime_error("Graph with output nodes is already running on another context; "
+                                         "concurrent contexts must capture their outputs (ExecutionContext::setOutputCapture)");
+            }
+        }
+        
+        ~OutputFileLease() {
+            writers_.fetch_sub(1);
+        }
+        
+        OutputFileLease(const OutputFileLease&) = delete;
+        OutputFileLease& operator=(const OutputFileLease&) = delete;
+    };
+}
+
+GraphExecutor::GraphExecutor()
+    : plan_version_(0), writes_files_(false), file_writers_(0), mode_(ExecutionMode::Sequential), thread_count_(0),
+      use_buffer_pool_(true),
+      kernel_threading_(KernelThreading::Adaptive), incremental_(false), order_checks_(true), critical_path_(false) {
+    compile_options_.fuse_pointwise = true;
+    compile_options_.propagate_regions = true;
+}
+
+GraphExecutor::~GraphExecutor() {
+    // buffers pooled for this graph's frames are of no use to whatever runs next
+    if (use_buffer_pool_) {
+        BufferPool::instance().trim();
+    }
+    
+    // runs leave OpenCV's thread count as their last lease set it
+    KernelThreadBudget::instance().restore();
 }
 
 void GraphExecutor::loadGraph(const std::string& json_file) {
@@ -19,6 +124,7 @@ void GraphExecutor::loadGraph(const std::string& json_file) {
 void GraphExecutor::loadGraph(const GraphConfig& config) {
     // clear previous results
     clearResults();
+    tuned_nodes_.clear();
     
     // build graph from configuration
     buildGraph(config);
@@ -26,9 +132,74 @@ void GraphExecutor::loadGraph(const GraphConfig& config) {
     // validate graph
     validateGraph();
     
-    // update stats
-    stats_.total_nodes = graph_.getNodeCount();
-    stats_.executed_nodes = 0;
+    // compile the execution plan once, every run reuses it
+    prepare();
+}
+
+void GraphExecutor::prepare() {
+    // tiled chains keep a pointer to the pool, so it is created up front
+    compile_options_.thread_pool = compile_options_.tile_size > 0 ? &getThreadPool() : nullptr;
+    std::unordered_map<NodeId, CheckStatistics> previous_checks;
+    std::unordered_map<NodeId, double> previous_costs;
+    for (size_t i = 0; i < plan_.size() && i < check_stats_.size(); ++i) {
+        if (plan_.rejects_frame[i]) {
+            previous_checks.emplace(plan_.nodes[i]->getId(), std::move(check_stats_[i]));
+        }
+        previous_costs.emplace(plan_.nodes[i]->getId(), node_costs_[i].load(std::memory_order_relaxed));
+    }
+    plan_ = ExecutionPlan::compile(graph_, compile_options_);
+    
+    // measurements follow their nodes into the new slots
+    check_stats_.assign(plan_.size(), CheckStatistics());
+    node_costs_ = std::vector<std::atomic<double>>(plan_.size());
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        auto check = previous_checks.find(plan_.nodes[i]->getId());
+        if (check != previous_checks.end()) {
+            check_stats_[i] = std::move(check->second);
+        }
+        auto cost = previous_costs.find(plan_.nodes[i]->getId());
+        node_costs_[i].store(cost != previous_costs.end() ? cost->second : 0.0, std::memory_order_relaxed);
+    }
+    writes_files_ = std::find(plan_.is_output.begin(), plan_.is_output.end(), true) != plan_.is_output.end();
+    
+    // contexts sized for the previous plan re-attach on their next run
+    ++plan_version_;
+    updateRetainedResults();
+    
+    // the plan now reflects every node's configuration, and changed nodes parse their
+    // parameters once for all the runs that follow
+    for (const auto& members : plan_.members) {
+        for (GraphNode* member : members) {
+            if (member->isDirty()) {
+                member->prepare();
+                member->clearDirty();
+            }
+        }
+    }
+    
+    attachContext(default_context_);
+}
+
+void GraphExecutor::update() {
+    if (!hasNodeChanges()) {
+        return;
+    }
+    
+    // fused lookup tables and required regions depend on the node parameters
+    if (incremental_) {
+        // a node tuned once is likely tuned again, its inputs are worth keeping
+        for (const auto& members : plan_.members) {
+            for (const GraphNode* member : members) {
+                if (member->isDirty()) {
+                    tuned_nodes_.insert(member->getId());
+                }
+            }
+        }
+        recompileIncremental();
+    } else {
+        clearResults();
+        prepare();
+    }
 }
 
 cv::Mat GraphExecutor::execute() {
@@ -36,79 +207,1106 @@ cv::Mat GraphExecutor::execute() {
 }
 
 cv::Mat GraphExecutor::executeWithProgress(std::function<void(const std::string&, int, int)> progress_callback) {
+    update();
+    return executeWithProgress(default_context_, progress_callback);
+}
+
+cv::Mat GraphExecutor::execute(ExecutionContext& context) const {
+    return executeWithProgress(context, nullptr);
+}
+
+cv::Mat GraphExecutor::executeWithProgress(ExecutionContext& context,
+                                           std::function<void(const std::string&, int, int)> progress_callback) const {
     auto start_time = std::chrono::high_resolution_clock::now();
     
-    // clear previous results
-    clearResults();
+    // clear previous results (or, in incremental mode, only the out of date ones)
+    beginRun(context);
     
-    // get topological order for execution
-    auto execution_order = graph_.getTopologicalOrder();
-    
-    if (execution_order.empty()) {
+    if (plan_.empty()) {
         throw std::runtime_error("Graph has no valid execution order (possibly cyclic)");
     }
     
-    // execute nodes in topological order
-    for (size_t i = 0; i < execution_order.size(); ++i) {
-        const auto& node_id = execution_order[i];
-        
-        // report progress
-        if (progress_callback) {
-            auto node = graph_.getNode(node_id);
-            std::string node_name = node ? node->getName() : "Unknown";
-            progress_callback(node_name, i + 1, execution_order.size());
+    // output nodes save their files only on one context at a time
+    std::optional<OutputFileLease> file_lease;
+    if (writes_files_ && !context.capture_outputs_) {
+        file_lease.emplace(file_writers_);
+    }
+    
+    // route every cv::Mat allocation of this run through the buffer pool
+    std::optional<ScopedBufferPool> pool_scope;
+    size_t fresh_before = BufferPool::instance().getFreshAllocationCount();
+    if (use_buffer_pool_) {
+        pool_scope.emplace();
+    }
+    
+    // execute nodes using the selected scheduling strategy
+    if (mode_ == ExecutionMode::Parallel) {
+        executeParallel(context, progress_callback);
+    } else if (mode_ == ExecutionMode::Dataflow) {
+        executeDataflow(context, progress_callback);
+    } else {
+        executeSequential(context, progress_callback);
+    }
+    
+    collectStats(context, start_time);
+    context.stats_.fresh_buffer_allocations = BufferPool::instance().getFreshAllocationCount() - fresh_before;
+    trimOnGeometryChange(context);
+    
+    // return final result (first output node, or the last node by id)
+    return context.getResult();
+}
+
+void GraphExecutor::collectStats(ExecutionContext& context, std::chrono::high_resolution_clock::time_point start_time) const {
+    // calculate execution time (a fused chain is scheduled and counted as one node)
+    auto end_time = std::chrono::high_resolution_clock::now();
+    ExecutionStats& stats = context.stats_;
+    stats.total_nodes = static_cast<int>(plan_.size());
+    stats.executed_nodes = context.executed_nodes_.load();
+    stats.peak_image_bytes = context.peak_resident_bytes_;
+    stats.cache_hits = context.cache_hits_.load();
+    stats.cache_misses = context.cache_misses_.load();
+    stats.reused_nodes = context.reused_nodes_.load();
+    stats.skipped_nodes = context.skipped_nodes_.load();
+    stats.rejected = context.rejected_.load();
+    stats.rejected_by = context.rejected_by_;
+    stats.shed_nodes = context.shed_nodes_.load();
+    stats.degraded = stats.shed_nodes > 0;
+    stats.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+}
+
+void GraphExecutor::trimOnGeometryChange(ExecutionContext& context) const {
+    if (context.geometry_changed_.exchange(false) && use_buffer_pool_) {
+        BufferPool::instance().trim();
+    }
+}
+
+void GraphExecutor::setPointwiseFusionEnabled(bool enabled) {
+    if (compile_options_.fuse_pointwise != enabled) {
+        compile_options_.fuse_pointwise = enabled;
+        recompile();
+    }
+}
+
+void GraphExecutor::setRegionPropagationEnabled(bool enabled) {
+    if (compile_options_.propagate_regions != enabled) {
+        compile_options_.propagate_regions = enabled;
+        recompile();
+    }
+}
+
+void GraphExecutor::setTileSize(int tile_size) {
+    tile_size = std::max(tile_size, 0);
+    if (compile_options_.tile_size != tile_size) {
+        compile_options_.tile_size = tile_size;
+        recompile();
+    }
+}
+
+void GraphExecutor::setResultCacheBudget(size_t budget_bytes) {
+    result_cache_.setBudget(budget_bytes);
+}
+
+void GraphExecutor::clearResultCache() {
+    result_cache_.clear();
+}
+
+void GraphExecutor::setIncrementalExecutionEnabled(bool enabled) {
+    if (incremental_ != enabled) {
+        incremental_ = enabled;
+        clearResults();
+        updateRetainedResults();
+    }
+}
+
+void GraphExecutor::updateRetainedResults() {
+    // the final result, and whatever a consumer may read again while the result itself
+    // stays valid: nodes with side effects run every time, tuned nodes are rerun on their
+    // own; anything else is only read again after it was recomputed anyway
+    retained_.assign(plan_.size(), 0);
+    if (!incremental_) {
+        return;
+    }
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        bool retained = i == plan_.result_slot;
+        for (size_t consumer : plan_.consumers[i]) {
+            retained = retained || plan_.nodes[consumer]->hasSideEffects();
+            for (const GraphNode* member : plan_.members[consumer]) {
+                retained = retained || tuned_nodes_.count(member->getId()) > 0;
+            }
         }
+        retained_[i] = retained;
+    }
+}
+
+size_t GraphExecutor::findSlot(const NodeId& node_id) const {
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        if (plan_.nodes[i]->getId() == node_id) {
+            return i;
+        }
+    }
+    return ExecutionPlan::npos;
+}
+
+bool GraphExecutor::hasNodeChanges() const {
+    for (const auto& members : plan_.members) {
+        for (const GraphNode* member : members) {
+            if (member->isDirty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void GraphExecutor::attachContext(ExecutionContext& context) const {
+    // result slots and input lists are allocated once per plan and reused by every run
+    context.plan_version_ = plan_version_;
+    context.result_slot_ = plan_.result_slot;
+    context.node_results_.assign(plan_.size(), cv::Mat());
+    context.released_ = std::vector<std::atomic<uint8_t>>(plan_.size());
+    context.left_empty_ = std::vector<std::atomic<uint8_t>>(plan_.size());
+    context.node_keys_.assign(plan_.size(), 0);
+    context.node_inputs_.assign(plan_.size(), std::vector<cv::Mat>());
+    context.run_node_.assign(plan_.size(), true);
+    context.node_shed_.assign(plan_.size(), 0);
+    context.node_priority_.assign(plan_.size(), std::numeric_limits<double>::infinity());
+    context.source_geometry_.assign(plan_.size(), std::make_pair(cv::Size(), -1));
+    context.pending_consumers_ = std::vector<std::atomic<size_t>>(plan_.size());
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        context.node_inputs_[i].reserve(plan_.input_slots[i].size());
+    }
+    context.injected_.assign(plan_.size(), nullptr);
+    context.inputs_resolved_ = false;
+    
+    // scheduler scratch, so runs allocate nothing per node
+    context.out_of_date_.assign(plan_.size(), 0);
+    context.remaining_inputs_ = std::vector<std::atomic<size_t>>(plan_.size());
+    context.ready_nodes_.clear();
+    context.ready_nodes_.reserve(plan_.size());
+    context.finish_times_.assign(plan_.size(), 0.0);
+    size_t widest_level = 0;
+    for (const auto& level : plan_.levels) {
+        widest_level = std::max(widest_level, level.size());
+    }
+    context.level_order_.reserve(widest_level);
+    context.buffer_refs_.clear();
+    context.resident_bytes_ = 0;
+}
+
+void GraphExecutor::beginRun(ExecutionContext& context) const {
+    if (context.plan_version_ != plan_version_) {
+        attachContext(context);
+    }
+    
+    // an injected image replaces what a source node would load (resolved to its slot
+    // once, until the context gets an input for another node or a new plan)
+    if (!context.inputs_resolved_) {
+        context.injected_.assign(plan_.size(), nullptr);
+        for (const auto& input : context.inputs_) {
+            auto source = plan_.sources.find(input.first);
+            if (source == plan_.sources.end()) {
+                throw std::runtime_error("Injected input is not a source node of the graph: " + input.first);
+            }
+            context.injected_[source->second] = &input.second;
+        }
+        context.inputs_resolved_ = true;
+    }
+    const std::vector<const ExecutionContext::InjectedInput*>& injected = context.injected_;
+    
+    if (!incremental_) {
+        for (auto& result : context.node_results_) {
+            result.release();
+        }
+    }
+    resetRunStats(context);
+    
+    // a result is out of date if it is missing (and was not released while still valid),
+    // computed from an out of date input, or loaded from an input image that was replaced;
+    // nodes with side effects run anyway, but their unchanged result changes nothing
+    // downstream
+    std::vector<uint8_t>& out_of_date = context.out_of_date_;
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        bool missing = context.node_results_[i].empty() && !context.released_[i].load(std::memory_order_relaxed);
+        bool stale = missing || context.node_shed_[i] || (injected[i] && injected[i]->changed);
+        for (size_t producer : plan_.producers[i]) {
+            stale = stale || out_of_date[producer];
+        }
+        out_of_date[i] = stale;
+        context.run_node_[i] = stale || plan_.nodes[i]->hasSideEffects();
         
-        // execute node
-        cv::Mat result = executeNode(node_id);
-        
-        // cache result
-        node_results_[node_id] = result;
-        stats_.executed_nodes++;
+        // dropped up front, so a run that fails half way leaves no stale result behind
+        if (stale) {
+            context.node_results_[i].release();
+            context.released_[i].store(0, std::memory_order_relaxed);
+        }
+        context.left_empty_[i].store(0, std::memory_order_relaxed);
     }
     
-    // calculate execution time
-    auto end_time = std::chrono::high_resolution_clock::now();
-    stats_.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    // a released result is recomputed (unchanged) if a node that runs reads it; consumers
+    // come later in plan order, so one backward pass suffices
+    for (size_t i = plan_.size(); i-- > 0;) {
+        if (!context.run_node_[i] && context.node_results_[i].empty()) {
+            for (size_t consumer : plan_.consumers[i]) {
+                context.run_node_[i] = context.run_node_[i] || context.run_node_[consumer];
+            }
+        }
+    }
+    for (auto& input : context.inputs_) {
+        input.second.changed = false;
+    }
+    context.node_shed_.assign(plan_.size(), 0);
     
-    // return final result (last node in topological order)
-    return getResult();
+    // the earlier of the fixed deadline and this run's budget
+    auto now = std::chrono::steady_clock::now();
+    context.run_deadline_ = context.deadline_;
+    if (context.time_budget_.count() > 0 && now + context.time_budget_ < context.run_deadline_) {
+        context.run_deadline_ = now + context.time_budget_;
+    }
+    updatePriorities(context);
+    
+    // the measured cost of the required work the deadline has to fit
+    int64_t required_us = 0;
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        if (context.run_node_[i] && !plan_.nodes[i]->isOptional()) {
+            required_us += static_cast<int64_t>(context.node_cost_[i] * 1000.0);
+        }
+    }
+    context.remaining_required_us_.store(required_us);
 }
 
-cv::Mat GraphExecutor::getResult() const {
-    if (node_results_.empty()) {
-        return cv::Mat();
+void GraphExecutor::updatePriorities(ExecutionContext& context) const {
+    // non-checks keep plan order behind every check that is expected to reject
+    context.node_priority_.assign(plan_.size(), std::numeric_limits<double>::infinity());
+    context.node_rank_.assign(plan_.size(), 0.0);
+    context.has_priorities_ = false;
+    
+    if (order_checks_) {
+        std::lock_guard<std::mutex> lock(check_mutex_);
+        for (size_t i = 0; i < plan_.size(); ++i) {
+            if (plan_.rejects_frame[i]) {
+                context.node_priority_[i] = check_stats_[i].getRank();
+                context.has_priorities_ = context.has_priorities_ || context.node_priority_[i] < std::numeric_limits<double>::infinity();
+            }
+        }
     }
     
-    // find output nodes
-    auto output_nodes = graph_.getNodesByType("output");
+    // costs measured so far, for the ranks, the deadline and the kernel width of this run;
+    // a run nothing of which uses them neither reads nor records them
+    context.measure_costs_ = critical_path_ || context.run_deadline_ != std::chrono::steady_clock::time_point::max() ||
+                             (mode_ != ExecutionMode::Sequential && kernel_threading_ == KernelThreading::Adaptive);
+    context.node_cost_.assign(plan_.size(), 0.0);
+    if (context.measure_costs_) {
+        for (size_t i = 0; i < plan_.size(); ++i) {
+            context.node_cost_[i] = node_costs_[i].load(std::memory_order_relaxed);
+        }
+    }
     
-    if (output_nodes.empty()) {
-        // if no output nodes, return result of last executed node
-        return node_results_.rbegin()->second;
+    // upward rank: a node's cost plus the most expensive path from it to the end of the
+    // graph (consumers come later in plan order, so one backward pass suffices)
+    if (critical_path_) {
+        for (size_t i = plan_.size(); i-- > 0;) {
+            double downstream = 0.0;
+            for (size_t consumer : plan_.consumers[i]) {
+                downstream = std::max(downstream, context.node_rank_[consumer]);
+            }
+            context.node_rank_[i] = context.node_cost_[i] + downstream;
+            context.has_priorities_ = context.has_priorities_ || context.node_rank_[i] > 0.0;
+        }
+    }
+}
+
+bool GraphExecutor::missesDeadline(const ExecutionContext& context, size_t node_index) const {
+    if (!plan_.nodes[node_index]->isOptional() || context.run_deadline_ == std::chrono::steady_clock::time_point::max()) {
+        return false;
     }
     
-    // return first output node result
-    auto first_output = output_nodes[0];
-    auto it = node_results_.find(first_output);
-    if (it != node_results_.end()) {
-        return it->second;
+    // projected completion: this node and the required work left, one after another (with
+    // parallel workers an upper bound, so frames degrade early rather than late)
+    std::chrono::duration<double, std::milli> work_left(context.node_cost_[node_index] +
+                                                        context.remaining_required_us_.load() / 1000.0);
+    auto projected = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(work_left);
+    return projected > context.run_deadline_;
+}
+
+bool GraphExecutor::runsBefore(const ExecutionContext& context, size_t a, size_t b) const {
+    if (context.node_priority_[a] != context.node_priority_[b]) {
+        return context.node_priority_[a] < context.node_priority_[b];
+    }
+    if (context.node_rank_[a] != context.node_rank_[b]) {
+        return context.node_rank_[a] > context.node_rank_[b];
     }
+    return a < b;
+}
+
+void GraphExecutor::sortByPriority(const ExecutionContext& context, std::vector<size_t>& nodes) const {
+    std::sort(nodes.begin(), nodes.end(), [this, &context](size_t a, size_t b) {
+        return runsBefore(context, a, b);
+    });
+}
+
+void GraphExecutor::recordNodeCost(size_t node_index, double cost_ms) const {
+    // concurrent contexts may measure the same node; each sample is folded in exactly once
+    std::atomic<double>& cost = node_costs_[node_index];
+    double current = cost.load(std::memory_order_relaxed);
+    double smoothed;
+    do {
+        smoothed = current == 0.0 ? cost_ms : current + cost_smoothing * (cost_ms - current);
+    } while (!cost.compare_exchange_weak(current, smoothed, std::memory_order_relaxed));
+}
+
+double GraphExecutor::getNodeCost(const NodeId& node_id) const {
+    size_t slot = findSlot(node_id);
+    return slot != ExecutionPlan::npos ? node_costs_[slot].load(std::memory_order_relaxed) : 0.0;
+}
+
+size_t GraphExecutor::kernelWidth(size_t concurrency) const {
+    // serial kernels: one lease as wide as the machine leaves every kernel one thread
+    if (kernel_threading_ == KernelThreading::Serial) {
+        return KernelThreadBudget::instance().getCores();
+    }
+    if (kernel_threading_ == KernelThreading::Unmanaged) {
+        return 0;
+    }
+    return std::max<size_t>(concurrency, 1);
+}
+
+size_t GraphExecutor::expectedConcurrency(ExecutionContext& context, size_t worker_count) const {
+    // average parallelism of the run: its work over its longest path (plan order is
+    // topological, so one forward pass finds the path)
+    double work = 0.0;
+    double critical_path = 0.0;
+    std::vector<double>& finish = context.finish_times_;
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        double start = 0.0;
+        for (size_t producer : plan_.producers[i]) {
+            start = std::max(start, finish[producer]);
+        }
+        double cost = context.run_node_[i] ? context.node_cost_[i] : 0.0;
+        finish[i] = start + cost;
+        work += cost;
+        critical_path = std::max(critical_path, finish[i]);
+    }
+    
+    size_t concurrency = 1;
+    if (critical_path > 0.0) {
+        concurrency = static_cast<size_t>(std::ceil(work / critical_path));
+    } else {
+        for (const auto& level : plan_.levels) {
+            concurrency = std::max(concurrency, level.size());
+        }
+    }
+    return std::min(concurrency, worker_count);
+}
+
+CheckStatistics GraphExecutor::getCheckStatistics(const NodeId& node_id) const {
+    size_t slot = findSlot(node_id);
+    std::lock_guard<std::mutex> lock(check_mutex_);
+    return slot != ExecutionPlan::npos ? check_stats_[slot] : CheckStatistics();
+}
+
+void GraphExecutor::recompileIncremental() {
+    // a node's result stays valid if neither it nor anything upstream changed
+    ExecutionContext& context = default_context_;
+    std::vector<bool> changed(plan_.size(), false);
+    std::unordered_map<NodeId, size_t> valid;
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        bool node_changed = false;
+        for (const GraphNode* member : plan_.members[i]) {
+            node_changed = node_changed || member->isDirty();
+        }
+        for (size_t producer : plan_.producers[i]) {
+            node_changed = node_changed || changed[producer];
+        }
+        changed[i] = node_changed;
+        if (!node_changed && i < context.node_results_.size() &&
+            (!context.node_results_[i].empty() || context.released_[i].load(std::memory_order_relaxed))) {
+            valid[plan_.nodes[i]->getId()] = i;
+        }
+    }
+    
+    std::vector<cv::Mat> previous_results = std::move(context.node_results_);
+    std::vector<std::atomic<uint8_t>> previous_released = std::move(context.released_);
+    std::vector<uint64_t> previous_keys = std::move(context.node_keys_);
+    std::vector<ROI> previous_regions = std::move(plan_.required_regions);
+    prepare();
+    
+    // fusion may group the nodes differently now, so results move over by plan node id,
+    // and only if downstream still reads the same region of them
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        auto it = valid.find(plan_.nodes[i]->getId());
+        if (it != valid.end() && ROITools::isSame(previous_regions[it->second], plan_.required_regions[i])) {
+            context.node_results_[i] = previous_results[it->second];
+            context.released_[i].store(previous_released[it->second].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            context.node_keys_[i] = previous_keys[it->second];
+        }
+    }
+}
+
+void GraphExecutor::recompile() {
+    // only an already loaded graph has a plan to replace
+    if (!graph_.isEmpty()) {
+        clearResults();
+        prepare();
+    }
+}
+
+void GraphExecutor::setThreadCount(size_t thread_count) {
+    thread_count_ = thread_count;
+    
+    // recreate the pool lazily with the new size
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        thread_pool_.reset();
+    }
+    
+    // tiled chains point at the old pool
+    if (compile_options_.thread_pool) {
+        recompile();
+    }
+}
+
+void GraphExecutor::executeSequential(ExecutionContext& context,
+                                      const std::function<void(const std::string&, int, int)>& progress_callback) const {
+    // ranked nodes are dispatched by priority instead
+    if (context.has_priorities_) {
+        executeListScheduled(context, 1, progress_callback);
+        return;
+    }
+    
+    // one node at a time, its kernels may use the whole machine
+    ScopedKernelThreads kernel_threads(kernelWidth(1));
     
-    return cv::Mat();
+    // plan nodes are stored in topological order
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        reportProgress(context, i, progress_callback);
+        executeNode(context, i);
+    }
+}
+
+void GraphExecutor::executeParallel(ExecutionContext& context,
+                                    const std::function<void(const std::string&, int, int)>& progress_callback) const {
+    ThreadPool& pool = getThreadPool();
+    size_t worker_count = pool.getThreadCount() + 1;
+    
+    // the kernels share the cores with the nodes expected to run alongside them; one width
+    // for the whole run, since every change of OpenCV's thread count resizes its pool
+    ScopedKernelThreads kernel_threads(kernelWidth(expectedConcurrency(context, worker_count)));
+    
+    // nodes within a level never depend on each other, so a level is one parallel batch
+    // (claimed in order, so ranked checks and the critical path go first)
+    std::vector<size_t>& ordered = context.level_order_;
+    for (const auto& level : plan_.levels) {
+        ordered = level;
+        if (context.has_priorities_) {
+            sortByPriority(context, ordered);
+        }
+        pool.parallelFor(ordered.size(), [&](size_t i) {
+            reportProgress(context, ordered[i], progress_callback);
+            executeNode(context, ordered[i]);
+        });
+    }
+}
+
+void GraphExecutor::executeDataflow(ExecutionContext& context,
+                                    const std::function<void(const std::string&, int, int)>& progress_callback) const {
+    size_t node_count = plan_.size();
+    
+    ThreadPool& pool = getThreadPool();
+    size_t worker_count = pool.getThreadCount() + 1;
+    
+    // ranked nodes are dispatched from one shared ready list instead
+    if (context.has_priorities_) {
+        executeListScheduled(context, worker_count, progress_callback);
+        return;
+    }
+    
+    // the kernels share the cores with the nodes expected to run alongside them
+    ScopedKernelThreads kernel_threads(kernelWidth(expectedConcurrency(context, worker_count)));
+    
+    // remaining-producer counters per node
+    std::vector<std::atomic<size_t>>& remaining_inputs = context.remaining_inputs_;
+    for (size_t i = 0; i < node_count; ++i) {
+        remaining_inputs[i].store(plan_.producers[i].size());
+    }
+    
+    // one queue per worker (the calling thread counts as a worker), emptied of whatever
+    // an aborted run left behind
+    std::vector<WorkStealingQueue>& queues = context.work_queues_;
+    if (queues.size() != worker_count) {
+        queues = std::vector<WorkStealingQueue>(worker_count);
+    }
+    for (WorkStealingQueue& queue : queues) {
+        size_t stale = 0;
+        while (queue.pop(stale)) {
+        }
+    }
+    
+    // spread the source nodes over the workers (queued_nodes: ready nodes nobody took yet)
+    std::atomic<size_t> queued_nodes{0};
+    size_t next_queue = 0;
+    for (size_t i = 0; i < node_count; ++i) {
+        if (plan_.producers[i].empty()) {
+            queued_nodes.fetch_add(1);
+            queues[next_queue].push(i);
+            next_queue = (next_queue + 1) % worker_count;
+        }
+    }
+    
+    std::atomic<size_t> completed_nodes{0};
+    std::atomic<bool> aborted{false};
+    
+    // idle workers sleep until a node becomes ready or the run completes or aborts; the
+    // state changes before the mutex is taken, so no wake-up is lost
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    auto wake = [&](bool all) {
+        { std::lock_guard<std::mutex> lock(idle_mutex); }
+        if (all) {
+            idle.notify_all();
+        } else {
+            idle.notify_one();
+        }
+    };
+    
+    pool.parallelFor(worker_count, [&](size_t worker) {
+        while (completed_nodes.load() < node_count && !aborted.load()) {
+            // own work first (newest, cache-warm), otherwise steal the oldest task of another worker
+            size_t task = 0;
+            bool found = queues[worker].pop(task);
+            for (size_t k = 1; !found && k < worker_count; ++k) {
+                found = queues[(worker + k) % worker_count].steal(task);
+            }
+            
+            if (!found) {
+                std::unique_lock<std::mutex> lock(idle_mutex);
+                idle.wait(lock, [&]() {
+                    return queued_nodes.load() > 0 || completed_nodes.load() == node_count || aborted.load();
+                });
+                continue;
+            }
+            queued_nodes.fetch_sub(1);
+            
+            try {
+                reportProgress(context, task, progress_callback);
+                executeNode(context, task);
+            } catch (...) {
+                // let the other workers drain out, the pool rethrows the error
+                aborted.store(true);
+                wake(true);
+                throw;
+            }
+            
+            // the last producer to finish makes the consumer ready
+            for (size_t consumer : plan_.consumers[task]) {
+                if (remaining_inputs[consumer].fetch_sub(1) == 1) {
+                    queued_nodes.fetch_add(1);
+                    queues[worker].push(consumer);
+                    wake(false);
+                }
+            }
+            if (completed_nodes.fetch_add(1) + 1 == node_count) {
+                wake(true);
+            }
+        }
+    });
+}
+
+void GraphExecutor::executeListScheduled(ExecutionContext& context, size_t worker_count,
+                                         const std::function<void(const std::string&, int, int)>& progress_callback) const {
+    size_t node_count = plan_.size();
+    
+    // list scheduling: whenever a worker is free it takes the best ready node, i.e. a check
+    // likely to reject the frame cheaply, otherwise the node with the highest upward rank
+    // (a heap in the context's scratch, the best node on top)
+    auto runs_later = [this, &context](size_t a, size_t b) { return runsBefore(context, b, a); };
+    std::vector<size_t>& ready = context.ready_nodes_;
+    std::vector<std::atomic<size_t>>& remaining_inputs = context.remaining_inputs_;
+    ready.clear();
+    for (size_t i = 0; i < node_count; ++i) {
+        remaining_inputs[i].store(plan_.producers[i].size());
+        if (plan_.producers[i].empty()) {
+            ready.push_back(i);
+            std::push_heap(ready.begin(), ready.end(), runs_later);
+        }
+    }
+    
+    std::mutex ready_mutex;   // guards ready, remaining_inputs and completed_nodes
+    std::condition_variable changed;  // a node became ready, or the run completed or aborted
+    size_t completed_nodes = 0;
+    std::atomic<bool> aborted{false};
+    
+    // the kernels share the cores with the nodes expected to run alongside them
+    ScopedKernelThreads kernel_threads(kernelWidth(expectedConcurrency(context, worker_count)));
+    
+    auto work = [&](size_t) {
+        while (true) {
+            // idle workers sleep until there is something to take
+            size_t task = 0;
+            {
+                std::unique_lock<std::mutex> lock(ready_mutex);
+                changed.wait(lock, [&]() { return !ready.empty() || completed_nodes == node_count || aborted.load(); });
+                if (completed_nodes == node_count || aborted.load()) {
+                    return;
+                }
+                std::pop_heap(ready.begin(), ready.end(), runs_later);
+                task = ready.back();
+                ready.pop_back();
+            }
+            
+            try {
+                reportProgress(context, task, progress_callback);
+                executeNode(context, task);
+            } catch (...) {
+                // let the other workers drain out, the pool rethrows the error
+                {
+                    std::lock_guard<std::mutex> lock(ready_mutex);
+                    aborted.store(true);
+                }
+                changed.notify_all();
+                throw;
+            }
+            
+            // this worker takes one newly ready node itself, the others are woken for the rest
+            size_t newly_ready = 0;
+            bool finished = false;
+            {
+                std::lock_guard<std::mutex> lock(ready_mutex);
+                for (size_t consumer : plan_.consumers[task]) {
+                    if (remaining_inputs[consumer].fetch_sub(1) == 1) {
+                        ready.push_back(consumer);
+                        std::push_heap(ready.begin(), ready.end(), runs_later);
+                        ++newly_ready;
+                    }
+                }
+                finished = ++completed_nodes == node_count;
+            }
+            if (finished || newly_ready > 1) {
+                changed.notify_all();
+            }
+        }
+    };
+    
+    if (worker_count > 1) {
+        getThreadPool().parallelFor(worker_count, work);
+    } else {
+        work(0);
+    }
+}
+
+StreamStats GraphExecutor::executeStream(const std::function<bool(ExecutionContext&)>& read_frame,
+                                         const std::function<void(ExecutionContext&)>& write_result,
+                                         const StreamOptions& options) const {
+    using Clock = std::chrono::high_resolution_clock;
+    if (plan_.empty()) {
+        throw std::runtime_error("Graph has no valid execution order (possibly cyclic)");
+    }
+    
+    size_t stage_count = options.stage_count;
+    if (stage_count == 0) {
+        stage_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    stage_count = std::min(stage_count, plan_.size());
+    size_t queue_capacity = std::max<size_t>(options.queue_capacity, 1);
+    
+    // every stage works on one frame and every queue holds a few more, each with its own context
+    std::vector<std::unique_ptr<ExecutionContext>> contexts;
+    for (size_t i = 0; i < stage_count + queue_capacity; ++i) {
+        contexts.push_back(std::make_unique<ExecutionContext>());
+        contexts.back()->setTimeBudget(options.time_budget);
+    }
+    std::vector<Clock::time_point> read_times(contexts.size());
+    
+    std::optional<ScopedBufferPool> pool_scope;
+    if (use_buffer_pool_) {
+        pool_scope.emplace();
+    }
+    
+    StreamStats stats;
+    double total_latency_ms = 0.0;
+    auto finishFrame = [&](size_t frame) {
+        ExecutionContext& context = *contexts[frame];
+        collectStats(context, read_times[frame]);
+        trimOnGeometryChange(context);
+        write_result(context);
+        std::chrono::duration<double, std::milli> latency = Clock::now() - read_times[frame];
+        total_latency_ms += latency.count();
+        stats.max_latency_ms = std::max(stats.max_latency_ms, latency.count());
+        ++stats.frames;
+    };
+    
+    // the first frame runs alone on the calling thread and measures what each node costs
+    auto stream_start = Clock::now();
+    read_times[0] = stream_start;
+    if (!read_frame(*contexts[0])) {
+        return stats;
+    }
+    
+    // frames whose output nodes save files hold the lease until the stream ends (stages
+    // run one frame at a time, so the stream itself writes them in order)
+    std::optional<OutputFileLease> file_lease;
+    auto leaseFiles = [&](const ExecutionContext& context) {
+        if (writes_files_ && !context.capture_outputs_ && !file_lease) {
+            file_lease.emplace(file_writers_);
+        }
+    };
+    leaseFiles(*contexts[0]);
+    beginRun(*contexts[0]);
+    ScopedKernelThreads kernel_threads(kernelWidth(1));
+    std::vector<double> node_costs(plan_.size());
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        auto start_time = Clock::now();
+        executeNode(*contexts[0], i);
+        node_costs[i] = std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+    }
+    finishFrame(0);
+    
+    // plan order is topological, so contiguous stages only ever hand frames downstream
+    std::vector<size_t> stage_begin = partitionByCost(node_costs, stage_count);
+    stage_begin.push_back(plan_.size());
+    stats.stage_nodes.resize(stage_count);
+    for (size_t stage = 0; stage < stage_count; ++stage) {
+        for (size_t i = stage_begin[stage]; i < stage_begin[stage + 1]; ++i) {
+            stats.stage_nodes[stage].push_back(plan_.nodes[i]->getId());
+        }
+    }
+    
+    // queues[s] feeds stage s, queues[stage_count] returns contexts to the reader; an
+    // index past the contexts marks the end of the stream
+    const size_t end_of_stream = contexts.size();
+    std::vector<std::unique_ptr<SpscQueue>> queues;
+    for (size_t stage = 0; stage < stage_count; ++stage) {
+        queues.push_back(std::make_unique<SpscQueue>(queue_capacity));
+    }
+    queues.push_back(std::make_unique<SpscQueue>(contexts.size()));
+    for (size_t frame = 0; frame < contexts.size(); ++frame) {
+        queues[stage_count]->tryPush(frame);
+    }
+    
+    std::atomic<bool> aborted{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            aborted.store(true);
+        }
+        for (auto& queue : queues) {
+            queue->wake();
+        }
+    };
+    
+    // threads sleep on full and empty queues until the other side moves or the stream aborts
+    auto push = [&](SpscQueue& queue, size_t item) {
+        queue.push(item, aborted);
+    };
+    auto pop = [&](SpscQueue& queue, size_t& item) {
+        return queue.pop(item, aborted);
+    };
+    
+    // every stage runs one node at a time, their kernels share the cores
+    kernel_threads.setWidth(kernelWidth(stage_count));
+    
+    std::vector<double> busy_ms(stage_count, 0.0);
+    std::vector<std::thread> stage_threads;
+    for (size_t stage = 0; stage < stage_count; ++stage) {
+        stage_threads.emplace_back([&, stage]() {
+            BufferPoolThreadScope pooled(use_buffer_pool_);
+            try {
+                size_t frame = 0;
+                while (!aborted.load() && pop(*queues[stage], frame) && frame != end_of_stream) {
+                    auto start_time = Clock::now();
+                    for (size_t i = stage_begin[stage]; i < stage_begin[stage + 1]; ++i) {
+                        executeNode(*contexts[frame], i);
+                    }
+                    if (stage + 1 == stage_count) {
+                        finishFrame(frame);
+                    }
+                    busy_ms[stage] += std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+                    push(*queues[stage + 1], frame);
+                }
+                if (stage + 1 < stage_count) {
+                    push(*queues[stage + 1], end_of_stream);
+                }
+            } catch (...) {
+                fail();
+            }
+        });
+        if (options.pin_threads) {
+            pinThread(stage_threads.back(), stage);
+        }
+    }
+    
+    // the calling thread reads frames into free contexts
+    try {
+        size_t frame = 0;
+        while (pop(*queues[stage_count], frame)) {
+            read_times[frame] = Clock::now();
+            if (!read_frame(*contexts[frame])) {
+                break;
+            }
+            leaseFiles(*contexts[frame]);
+            beginRun(*contexts[frame]);
+            push(*queues[0], frame);
+        }
+        push(*queues[0], end_of_stream);
+    } catch (...) {
+        fail();
+    }
+    for (auto& thread : stage_threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    
+    // the first frame ran alone, it counts for latency but not for the stage costs
+    auto stream_end = Clock::now();
+    stats.total_time = std::chrono::duration_cast<std::chrono::milliseconds>(stream_end - stream_start);
+    std::chrono::duration<double> total_seconds = stream_end - stream_start;
+    stats.throughput = total_seconds.count() > 0.0 ? stats.frames / total_seconds.count() : 0.0;
+    stats.mean_latency_ms = total_latency_ms / stats.frames;
+    for (double busy : busy_ms) {
+        stats.stage_costs_ms.push_back(stats.frames > 1 ? busy / (stats.frames - 1) : 0.0);
+    }
+    return stats;
+}
+
+BatchStats GraphExecutor::executeBatch(const std::vector<BatchItem>& items, const BatchOptions& options) const {
+    using Clock = std::chrono::high_resolution_clock;
+    auto start_time = Clock::now();
+    
+    // the images go to the graph's input node
+    NodeId input_id = options.input_id;
+    if (input_id.empty()) {
+        size_t input_count = 0;
+        for (const GraphNode* node : plan_.nodes) {
+            if (node->getType() == "input") {
+                input_id = node->getId();
+                ++input_count;
+            }
+        }
+        if (input_count != 1) {
+            throw std::runtime_error("Batch needs the id of the input node to feed (graph has " +
+                                     std::to_string(input_count) + " input nodes)");
+        }
+    }
+    
+    BatchStats stats;
+    stats.images = items.size();
+    if (items.empty()) {
+        return stats;
+    }
+    
+    size_t worker_count = options.parallel_images;
+    if (worker_count == 0) {
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    worker_count = std::min(worker_count, items.size());
+    size_t prefetch = std::max<size_t>(options.prefetch, 1);
+    size_t in_flight = worker_count + std::max<size_t>(options.write_behind, 1);
+    
+    // per image state; the reader decodes in order, workers claim in order and the calling
+    // thread saves in order, announcing every step on changed
+    struct BatchImage {
+        cv::Mat image;
+        cv::Mat result;
+        bool decoded = false;
+        bool done = false;
+        std::string error;
+    };
+    std::vector<BatchImage> images(items.size());
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t decoded = 0;   // images read so far
+    size_t claimed = 0;   // images taken by a worker so far
+    size_t saved = 0;     // images handed to the writer so far
+    
+    std::optional<ScopedBufferPool> pool_scope;
+    if (use_buffer_pool_) {
+        pool_scope.emplace();
+    }
+    
+    // reader: decodes up to prefetch images ahead of the workers
+    std::thread reader([&]() {
+        for (size_t i = 0; i < items.size(); ++i) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return i < claimed + prefetch; });
+            }
+            
+            cv::Mat image;
+            std::string error;
+            try {
+                image = cv::imread(items[i].input_path);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            if (image.empty() && error.empty()) {
+                error = "could not load image from: " + items[i].input_path;
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                images[i].image = image;
+                images[i].error = error;
+                images[i].decoded = true;
+                ++decoded;
+            }
+            changed.notify_all();
+        }
+    });
+    
+    // workers: each runs whole images on a context of its own
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < worker_count; ++w) {
+        workers.emplace_back([&]() {
+            ExecutionContext context;
+            context.setOutputCapture(true);
+            context.setTimeBudget(options.time_budget);
+            while (true) {
+                size_t i = 0;
+                cv::Mat image;
+                std::string error;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&]() {
+                        return claimed == items.size() || (claimed < decoded && claimed - saved < in_flight);
+                    });
+                    if (claimed == items.size()) {
+                        return;
+                    }
+                    i = claimed++;
+                    image = std::move(images[i].image);
+                    error = images[i].error;
+                }
+                changed.notify_all();
+                
+                // one failing image does not stop the batch
+                cv::Mat result;
+                if (error.empty()) {
+                    try {
+                        context.setInput(input_id, image);
+                        result = execute(context);
+                    } catch (const std::exception& e) {
+                        error = e.what();
+                    }
+                }
+                
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    images[i].result = result;
+                    images[i].error = error;
+                    images[i].done = true;
+                }
+                changed.notify_all();
+            }
+        });
+    }
+    
+    // writer: the calling thread saves results behind the workers
+    for (size_t i = 0; i < items.size(); ++i) {
+        BatchImage finished;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return images[i].done; });
+            finished = std::move(images[i]);
+        }
+        
+        if (finished.error.empty() && finished.result.empty()) {
+            // rejected by a check (or the result was switched off), nothing to save
+            ++stats.rejected;
+        } else if (finished.error.empty()) {
+            try {
+                if (!cv::imwrite(items[i].output_path, finished.result)) {
+                    finished.error = "could not save image to: " + items[i].output_path;
+                }
+            } catch (const std::exception& e) {
+                finished.error = e.what();
+            }
+        }
+        if (!finished.error.empty()) {
+            ++stats.failed;
+            stats.failures.emplace_back(items[i].input_path, finished.error);
+        } else if (!finished.result.empty()) {
+            ++stats.saved;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++saved;
+        }
+        changed.notify_all();
+    }
+    
+    reader.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    std::chrono::duration<double> total_seconds = Clock::now() - start_time;
+    stats.total_time = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_time);
+    stats.throughput = total_seconds.count() > 0.0 ? stats.images / total_seconds.count() : 0.0;
+    return stats;
+}
+
+void GraphExecutor::reportProgress(ExecutionContext& context, size_t node_index,
+                                   const std::function<void(const std::string&, int, int)>& progress_callback) const {
+    if (!progress_callback) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(context.progress_mutex_);
+    progress_callback(plan_.nodes[node_index]->getName(), ++context.started_nodes_, static_cast<int>(plan_.size()));
+}
+
+ThreadPool& GraphExecutor::getThreadPool() const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (!thread_pool_) {
+        thread_pool_ = std::make_unique<ThreadPool>(thread_count_);
+    }
+    return *thread_pool_;
+}
+
+cv::Mat GraphExecutor::getResult() const {
+    return default_context_.getResult();
 }
 
 void GraphExecutor::clearResults() {
-    node_results_.clear();
-    stats_.executed_nodes = 0;
-    stats_.execution_time = std::chrono::milliseconds(0);
+    default_context_.clearResults();
+    resetRunStats(default_context_);
+}
+
+void GraphExecutor::resetRunStats(ExecutionContext& context) const {
+    for (size_t i = 0; i < context.pending_consumers_.size(); ++i) {
+        context.pending_consumers_[i].store(plan_.consumers[i].size());
+    }
+    context.buffer_refs_.clear();
+    context.resident_bytes_ = 0;
+    context.peak_resident_bytes_ = 0;
+    context.started_nodes_ = 0;
+    context.executed_nodes_.store(0);
+    context.cache_hits_.store(0);
+    context.cache_misses_.store(0);
+    context.reused_nodes_.store(0);
+    context.skipped_nodes_.store(0);
+    context.rejected_.store(false);
+    context.rejected_by_.clear();
+    context.shed_nodes_.store(0);
+    context.stats_ = ExecutionStats();
+    context.stats_.total_nodes = static_cast<int>(plan_.size());
 }
 
 GraphExecutor::ExecutionStats GraphExecutor::getExecutionStats() const {
-    return stats_;
+    return default_context_.getStats();
 }
 
 void GraphExecutor::buildGraph(const GraphConfig& config) {
+    // batch all edits, the levels are sorted once when the plan is compiled
+    graph_.beginUpdate();
+    
     // create nodes from configuration
     for (const auto& node_config : config.nodes) {
         // create node using factory (use the 4-parameter overload)
@@ -135,6 +1333,7 @@ void GraphExecutor::buildGraph(const GraphConfig& config) {
         
         // set ROI
         node->setROI(node_config.roi);
+        node->setOptional(node_config.optional);
         
         // add node to graph (move the unique_ptr)
         graph_.addNode(std::move(node));
@@ -145,41 +1344,250 @@ void GraphExecutor::buildGraph(const GraphConfig& config) {
         graph_.addConnection(connection.from_node, connection.from_port, 
                            connection.to_node, connection.to_port);
     }
+    
+    graph_.endUpdate();
 }
 
-cv::Mat GraphExecutor::executeNode(const NodeId& node_id) {
-    auto node = graph_.getNode(node_id);
-    if (!node) {
-        throw std::runtime_error("Node not found: " + node_id);
+void GraphExecutor::executeNode(ExecutionContext& context, size_t node_index) const {
+    // an empty input comes from a failed predicate (or a node it switched off)
+    bool skip = context.rejected_.load();
+    for (size_t slot : plan_.input_slots[node_index]) {
+        skip = skip || context.node_results_[slot].empty();
+    }
+    
+    bool use_cache = result_cache_.getBudget() > 0;
+    bool reused = !context.run_node_[node_index];
+    if (reused) {
+        // incremental run: nothing this node depends on changed since it last ran (its
+        // inputs may have been released since)
+        context.reused_nodes_.fetch_add(1);
+    } else if (skip) {
+        // the slot stays empty (or, in incremental mode after a rejection, keeps a result
+        // that is still valid for the next run)
+        context.skipped_nodes_.fetch_add(1);
+    } else if (use_cache && lookupCachedResult(context, node_index)) {
+        // same node configuration on the same input content, the result is known
+        context.cache_hits_.fetch_add(1);
+    } else if (missesDeadline(context, node_index)) {
+        // out of time: an optional node passes its input on unprocessed (a source has none,
+        // so its consumers are skipped), keyed like that input
+        const std::vector<size_t>& input_slots = plan_.input_slots[node_index];
+        context.node_results_[node_index] = input_slots.empty() ? cv::Mat() : context.node_results_[input_slots[0]];
+        context.node_keys_[node_index] = input_slots.empty() ? 0 : context.node_keys_[input_slots[0]];
+        context.node_shed_[node_index] = 1;
+        context.shed_nodes_.fetch_add(1);
+    } else {
+        bool timed = context.measure_costs_ || plan_.rejects_frame[node_index];
+        auto start_time = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        computeResult(context, node_index);
+        if (use_cache) {
+            storeCachedResult(context, node_index);
+        }
+        
+        // measure rejecting checks for the ordering of later runs, and every node for the
+        // critical path, the deadline and the kernel width
+        if (timed) {
+            std::chrono::duration<double, std::milli> cost = std::chrono::steady_clock::now() - start_time;
+            if (plan_.rejects_frame[node_index]) {
+                std::lock_guard<std::mutex> lock(check_mutex_);
+                check_stats_[node_index].record(cost.count(), context.node_results_[node_index].empty());
+            }
+            if (context.measure_costs_) {
+                recordNodeCost(node_index, cost.count());
+            }
+        }
     }
     
-    // get input images for this node
-    std::vector<cv::Mat> inputs = getNodeInputs(node_id);
+    // this node no longer counts towards the required work left
+    GraphNode* node = plan_.nodes[node_index];
+    if (context.run_node_[node_index] && !node->isOptional()) {
+        context.remaining_required_us_.fetch_sub(static_cast<int64_t>(context.node_cost_[node_index] * 1000.0));
+    }
+    
+    // the first rejecting predicate to fail stops the frame
+    if (!skip && !reused && context.node_results_[node_index].empty() && plan_.rejects_frame[node_index] &&
+        !context.rejected_.exchange(true)) {
+        context.rejected_by_ = node->getId();
+    }
+    retainResult(context, context.node_results_[node_index]);
     
-    // execute node
-    cv::Mat result = node->execute(inputs, node->getROI(), node->getParameters());
+    // read by the last consumer of each producer, while this slot may already be released
+    // by a consumer of its own on another thread
+    bool left_empty = context.node_results_[node_index].empty() && !context.released_[node_index].load(std::memory_order_relaxed);
+    context.left_empty_[node_index].store(left_empty, std::memory_order_relaxed);
     
-    return result;
+    // this node was possibly the last reader of its producers' buffers
+    for (size_t producer : plan_.producers[node_index]) {
+        if (context.pending_consumers_[producer].fetch_sub(1) == 1 && !isReadAgain(context, producer)) {
+            releaseResult(context, producer);
+        }
+    }
+    
+    // nobody reads this result
+    if (plan_.consumers[node_index].empty()) {
+        releaseResult(context, node_index);
+    }
 }
 
-std::vector<cv::Mat> GraphExecutor::getNodeInputs(const NodeId& node_id) {
-    std::vector<cv::Mat> inputs;
-    
-    // get incoming connections
-    auto incoming = graph_.getIncomingConnections(node_id);
+void GraphExecutor::computeResult(ExecutionContext& context, size_t node_index) const {
+    GraphNode* node = plan_.nodes[node_index];
+    std::vector<cv::Mat>& inputs = context.node_inputs_[node_index];
+    inputs.clear();
     
-    for (const auto& connection : incoming) {
-        // get result from source node
-        auto it = node_results_.find(connection.from_node);
-        if (it != node_results_.end()) {
-            inputs.push_back(it->second);
+    // a source given an image by the context runs on it instead of loading its file
+    if (context.injected_[node_index]) {
+        context.node_results_[node_index] = context.injected_[node_index]->image;
+    } else if (context.capture_outputs_ && plan_.is_output[node_index] && plan_.input_slots[node_index].size() == 1) {
+        // the caller saves the result itself
+        context.node_results_[node_index] = context.node_results_[plan_.input_slots[node_index][0]];
+    } else if (!plan_.required_regions[node_index].full_image && node->isLocal()) {
+        // only part of the result is read downstream
+        context.node_results_[node_index] = executeRegion(context, node_index);
+    } else if (plan_.sole_consumer[node_index] && node->supportsInPlace()) {
+        // take the buffer out of the producer slot, this node is its only reader
+        size_t slot = plan_.input_slots[node_index][0];
+        cv::Mat image = context.node_results_[slot];
+        releaseResult(context, slot);
+        
+        // still shared (e.g. forwarded by a pass-through node), fall back to copying
+        if (image.u && image.u->refcount == 1) {
+            context.node_results_[node_index] = node->executeInPlace(image, node->getROI(), node->getParameters());
         } else {
-            // if source node hasn't been executed yet, this is an error
-            throw std::runtime_error("Source node not executed: " + connection.from_node);
+            inputs.push_back(image);
+            context.node_results_[node_index] = node->execute(inputs, node->getROI(), node->getParameters());
+        }
+    } else {
+        // gather input images from the producer slots (producers have already finished)
+        for (size_t slot : plan_.input_slots[node_index]) {
+            inputs.push_back(context.node_results_[slot]);
+        }
+        
+        // execute node
+        context.node_results_[node_index] = node->execute(inputs, node->getROI(), node->getParameters());
+    }
+    
+    // drop the extra references but keep the list's capacity for the next run
+    inputs.clear();
+    context.executed_nodes_.fetch_add(1);
+    
+    // a source of a new size or type makes the buffers pooled for the old one useless
+    if (plan_.input_slots[node_index].empty()) {
+        const cv::Mat& result = context.node_results_[node_index];
+        std::pair<cv::Size, int> geometry(result.size(), result.type());
+        std::pair<cv::Size, int>& previous = context.source_geometry_[node_index];
+        if (previous.second >= 0 && previous != geometry) {
+            context.geometry_changed_.store(true);
+        }
+        previous = geometry;
+    }
+}
+
+bool GraphExecutor::lookupCachedResult(ExecutionContext& context, size_t node_index) const {
+    // sources are keyed by the content they load, so they always run
+    if (plan_.input_slots[node_index].empty()) {
+        return false;
+    }
+    
+    // merkle key: what the node computes, the region it must get right, and the keys
+    // of its inputs (which already cover the whole upstream graph and its source pixels)
+    GraphNode* node = plan_.nodes[node_index];
+    uint64_t key = plan_.signature_keys[node_index];
+    for (size_t slot : plan_.input_slots[node_index]) {
+        key = ResultCache::combine(key, context.node_keys_[slot]);
+    }
+    context.node_keys_[node_index] = key;
+    
+    if (node->hasSideEffects()) {
+        return false;
+    }
+    if (!result_cache_.lookup(key, context.node_results_[node_index])) {
+        context.cache_misses_.fetch_add(1);
+        return false;
+    }
+    return true;
+}
+
+void GraphExecutor::storeCachedResult(ExecutionContext& context, size_t node_index) const {
+    GraphNode* node = plan_.nodes[node_index];
+    if (plan_.input_slots[node_index].empty()) {
+        // a source is keyed by what it loaded; it is reloaded every run, so not stored
+        context.node_keys_[node_index] = ResultCache::combine(plan_.signature_keys[node_index],
+                                                              ResultCache::hashImage(context.node_results_[node_index]));
+    } else if (!node->hasSideEffects()) {
+        result_cache_.insert(context.node_keys_[node_index], context.node_results_[node_index]);
+    }
+}
+
+cv::Mat GraphExecutor::executeRegion(ExecutionContext& context, size_t node_index) const {
+    GraphNode* node = plan_.nodes[node_index];
+    if (plan_.input_slots[node_index].size() != 1) {
+        throw std::runtime_error("local node requires exactly one input image: " + node->getId());
+    }
+    
+    size_t slot = plan_.input_slots[node_index][0];
+    cv::Mat image = context.node_results_[slot];
+    if (plan_.sole_consumer[node_index]) {
+        releaseResult(context, slot);
+    }
+    
+    // nothing this node changes is ever read, pass the input on
+    ROI region = ROITools::clip(plan_.required_regions[node_index], image.size());
+    if (ROITools::isEmpty(ROITools::clip(ROITools::intersect(node->getROI(), region), image.size()))) {
+        return image;
+    }
+    
+    // the region is rewritten in place, so work on a buffer nobody else can see
+    if (node->supportsInPlace() && (!image.u || image.u->refcount > 1)) {
+        image = image.clone();
+    }
+    return node->executeRegion(image, node->getROI(), region, node->getParameters());
+}
+
+void GraphExecutor::retainResult(ExecutionContext& context, const cv::Mat& result) const {
+    if (result.empty()) {
+        return;
+    }
+    
+    // views and pass-through results share a buffer, count each buffer once
+    std::lock_guard<std::mutex> lock(context.memory_mutex_);
+    if (context.buffer_refs_[result.datastart]++ == 0) {
+        context.resident_bytes_ += result.u ? result.u->size : static_cast<size_t>(result.dataend - result.datastart);
+        context.peak_resident_bytes_ = std::max(context.peak_resident_bytes_, context.resident_bytes_);
+    }
+}
+
+bool GraphExecutor::isReadAgain(const ExecutionContext& context, size_t slot) const {
+    // a consumer left without a result (a failed predicate, or a node it switched off) is
+    // out of date in the next incremental run and reads this result again; every consumer
+    // has finished, and its flag is ordered before this by the pending consumer count
+    if (!incremental_) {
+        return false;
+    }
+    for (size_t consumer : plan_.consumers[slot]) {
+        if (context.left_empty_[consumer].load(std::memory_order_relaxed)) {
+            return true;
         }
     }
+    return false;
+}
+
+void GraphExecutor::releaseResult(ExecutionContext& context, size_t slot) const {
+    // incremental mode keeps the results a later run may read again
+    if (slot == plan_.result_slot || (incremental_ && retained_[slot])) {
+        return;
+    }
     
-    return inputs;
+    cv::Mat& result = context.node_results_[slot];
+    if (!result.empty()) {
+        context.released_[slot].store(incremental_, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(context.memory_mutex_);
+        auto it = context.buffer_refs_.find(result.datastart);
+        if (it != context.buffer_refs_.end() && --it->second == 0) {
+            context.resident_bytes_ -= result.u ? result.u->size : static_cast<size_t>(result.dataend - result.datastart);
+            context.buffer_refs_.erase(it);
+        }
+    }
+    result.release();
 }
 
 void GraphExecutor::validateGraph() const {
@@ -1,16 +1,61 @@
 #include "graph_node.hpp"
 #include <algorithm>
+#include <iomanip>
+#include <sstream>
 
 // constructor for creating a new graph node
 GraphNode::GraphNode(const NodeId& id, const std::string& type)
-    : id_(id), type_(type), executed_(false) {
+    : id_(id), type_(type), dirty_(true), optional_(false) {
     // initialize member variables
     // id_ and type_ are set by the initializer list above
     // parameters_ is default-constructed (empty map)
     // input_node_ids_ and output_node_ids_ are default-constructed (empty vectors)
     // roi_ is default-constructed (all zeros, full_image = false)
-    // executed_ is set to false
-    // result_ is default-constructed (empty cv::Mat)
+    // dirty_ is set to true (a new node has never been compiled)
+    // optional_ is set to false (nodes are required unless configured otherwise)
+}
+
+// default: no buffer reuse, run the regular copying execute
+cv::Mat GraphNode::executeInPlace(cv::Mat& input, 
+                                  const ROI& roi, 
+                                  const std::map<std::string, double>& parameters) {
+    return execute(std::vector<cv::Mat>{input}, roi, parameters);
+}
+
+// default: process the part of the roi inside the region
+cv::Mat GraphNode::executeRegion(cv::Mat& input, 
+                                 const ROI& roi, 
+                                 const ROI& region, 
+                                 const std::map<std::string, double>& parameters) {
+    ROI processed = ROITools::intersect(roi, region);
+    if (ROITools::isEmpty(processed)) {
+        return input;
+    }
+    return executeInPlace(input, processed, parameters);
+}
+
+// text identifying what the node computes from its inputs
+std::string GraphNode::getSignature() const {
+    // parameters are printed exactly, so different values never share a signature
+    std::ostringstream signature;
+    signature << type_ << "(" << std::setprecision(17);
+    for (const auto& [key, value] : parameters_) {
+        signature << key << "=" << value << ";";
+    }
+    signature << ")";
+    if (!roi_.full_image) {
+        signature << "@" << roi_.x << "," << roi_.y << "," << roi_.width << "x" << roi_.height;
+    }
+    return signature.str();
+}
+
+// check if a failed condition rejects the whole frame
+bool GraphNode::rejectsFrame() const {
+    if (!isPredicate()) {
+        return false;
+    }
+    auto it = parameters_.find("reject");
+    return it != parameters_.end() && it->second != 0.0;
 }
 
 // add an input connection to this node
@@ -59,8 +104,14 @@ bool GraphNode::hasOutput(const NodeId& output_node_id) const {
     return std::find(output_node_ids_.begin(), output_node_ids_.end(), output_node_id) != output_node_ids_.end();
 }
 
-// reset the execution state of this node
-void GraphNode::resetExecution() {
-    executed_ = false;
-    result_ = cv::Mat(); // clear the result
-} 
\ No newline at end of file
+// id of a node standing in for several nodes, e.g. "brightness1+contrast1"
+NodeId joinNodeIds(const std::vector<GraphNode*>& nodes) {
+    NodeId id;
+    for (const auto* node : nodes) {
+        if (!id.empty()) {
+            id += "+";
+        }
+        id += node->getId();
+    }
+    return id;
+}
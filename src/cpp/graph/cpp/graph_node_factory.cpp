@@ -7,14 +7,18 @@ NodePtr GraphNodeFactory::createNode(const std::string& node_id,
                                     const std::map<std::string, double>& parameters,
                                     const std::string& image_path) {
     
+    NodePtr node;
     if (node_type == "input") {
-        return createInputNode(node_id, image_path);
+        node = createInputNode(node_id, image_path);
     } else if (node_type == "output") {
-        return createOutputNode(node_id, image_path);
+        node = createOutputNode(node_id, image_path);
     } else {
         // assume it's an operation type
-        return createOperationNode(node_id, node_type);
+        node = createOperationNode(node_id, node_type);
     }
+    
+    node->setParameters(parameters);
+    return node;
 }
 
 // create a node based on type and name (simplified interface)
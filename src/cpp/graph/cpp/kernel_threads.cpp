@@ -0,0 +1,80 @@
+#include "kernel_threads.hpp"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <thread>
+
+// constructor
+KernelThreadBudget::KernelThreadBudget()
+    : cores_(std::max(1u, std::thread::hardware_concurrency())), active_width_(0),
+      applied_threads_(0), previous_threads_(0), changed_(false) {}
+
+// process-wide budget
+KernelThreadBudget& KernelThreadBudget::instance() {
+    static KernelThreadBudget budget;
+    return budget;
+}
+
+// threads OpenCV's kernels may use right now
+int KernelThreadBudget::getKernelThreads() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_width_ > 0 ? applied_threads_ : cv::getNumThreads();
+}
+
+// change the total width of the held leases
+void KernelThreadBudget::resize(size_t from, size_t to) {
+    if (from == to) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!changed_) {
+        previous_threads_ = cv::getNumThreads();
+        changed_ = true;
+    }
+    active_width_ = active_width_ + to - from;
+    apply();
+}
+
+// give OpenCV its share of the cores
+void KernelThreadBudget::apply() {
+    // with no lease left the count stays, the next run most likely wants it again
+    if (active_width_ == 0) {
+        return;
+    }
+
+    // each running node's kernels get an equal share, at least one thread (1 runs kernels
+    // on the calling thread); changing the count resizes OpenCV's worker pool, so only a
+    // count OpenCV does not have already is set
+    applied_threads_ = static_cast<int>(std::max<size_t>(1, cores_ / active_width_));
+    if (applied_threads_ != cv::getNumThreads()) {
+        cv::setNumThreads(applied_threads_);
+    }
+}
+
+// give OpenCV back its previous setting
+void KernelThreadBudget::restore() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_width_ > 0 || !changed_) {
+        return;
+    }
+    if (previous_threads_ != cv::getNumThreads()) {
+        cv::setNumThreads(previous_threads_);
+    }
+    changed_ = false;
+}
+
+// take a lease for width nodes
+ScopedKernelThreads::ScopedKernelThreads(size_t width) : width_(0) {
+    setWidth(width);
+}
+
+// give the lease back
+ScopedKernelThreads::~ScopedKernelThreads() {
+    setWidth(0);
+}
+
+// change the width of the lease
+void ScopedKernelThreads::setWidth(size_t width) {
+    KernelThreadBudget::instance().resize(width_, width);
+    width_ = width;
+}
@@ -13,6 +13,20 @@ OperationNode::OperationNode(const NodeId& id, const std::string& operation_type
     }
 }
 
+// parse and validate the node's parameters once for all runs until they change
+void OperationNode::prepare() {
+    prepared_ = operation_->prepare(parameters_);
+}
+
+// prepared form of parameters
+PreparedParametersPtr OperationNode::getPrepared(const std::map<std::string, double>& parameters) const {
+    // the executor passes the node's own parameters, prepared when it compiled them
+    if (prepared_ && !dirty_ && &parameters == &parameters_) {
+        return prepared_;
+    }
+    return operation_->prepare(parameters);
+}
+
 // execute method - applies the wrapped operation
 cv::Mat OperationNode::execute(const std::vector<cv::Mat>& inputs, 
                               const ROI& roi, 
@@ -27,5 +41,25 @@ cv::Mat OperationNode::execute(const std::vector<cv::Mat>& inputs,
     }
     
     // apply the operation using the existing operation system
-    return operation_->execute(inputs[0], roi, parameters);
-} 
\ No newline at end of file
+    return operation_->run(inputs[0], roi, *getPrepared(parameters));
+} 
+
+// execute method - applies the wrapped operation, reusing the input buffer
+cv::Mat OperationNode::executeInPlace(cv::Mat& input, 
+                                      const ROI& roi, 
+                                      const std::map<std::string, double>& parameters) {
+    return operation_->runInPlace(input, roi, *getPrepared(parameters));
+}
+
+// execute method - applies the wrapped operation where the result is read
+cv::Mat OperationNode::executeRegion(cv::Mat& input, 
+                                     const ROI& roi, 
+                                     const ROI& region, 
+                                     const std::map<std::string, double>& parameters) {
+    return operation_->runRegion(input, roi, region, *getPrepared(parameters));
+}
+
+// region the wrapped operation reads for its roi and parameters
+ROI OperationNode::getRequiredRegion(const ROI& output_region) const {
+    return operation_->getRequiredRegion(output_region, getROI(), getParameters());
+}
@@ -0,0 +1,139 @@
+#include "result_cache.hpp"
+#include <cstring>
+
+namespace {
+    // final avalanche step (splitmix64), so every input bit affects every output bit
+    uint64_t mix(uint64_t value) {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebULL;
+        value ^= value >> 31;
+        return value;
+    }
+
+    // bytes an image keeps alive
+    size_t imageBytes(const cv::Mat& image) {
+        return image.u ? image.u->size : image.total() * image.elemSize();
+    }
+}
+
+// constructor
+ResultCache::ResultCache(size_t budget_bytes)
+    : budget_bytes_(budget_bytes), cached_bytes_(0), hits_(0), misses_(0) {
+}
+
+// find a result
+bool ResultCache::lookup(uint64_t key, cv::Mat& image) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        return false;
+    }
+
+    // move to the front, it is now the most recently used entry
+    entries_.splice(entries_.begin(), entries_, it->second);
+    image = it->second->image;
+    ++hits_;
+    return true;
+}
+
+// store a result
+void ResultCache::insert(uint64_t key, const cv::Mat& image) {
+    size_t bytes = imageBytes(image);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (image.empty() || bytes > budget_bytes_ || index_.count(key)) {
+        return;
+    }
+
+    entries_.push_front(Entry{key, image, bytes});
+    index_[key] = entries_.begin();
+    cached_bytes_ += bytes;
+    evict();
+}
+
+// drop least recently used entries until the cache fits its budget
+void ResultCache::evict() {
+    while (cached_bytes_ > budget_bytes_ && !entries_.empty()) {
+        cached_bytes_ -= entries_.back().bytes;
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+// set the byte budget
+void ResultCache::setBudget(size_t budget_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_bytes_ = budget_bytes;
+    evict();
+}
+
+// get the byte budget
+size_t ResultCache::getBudget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_bytes_;
+}
+
+// bytes held by cached results
+size_t ResultCache::getCachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+}
+
+// number of successful lookups so far
+size_t ResultCache::getHitCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+// number of failed lookups so far
+size_t ResultCache::getMissCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+// drop every entry
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    cached_bytes_ = 0;
+}
+
+// 64-bit hash of a byte range (fnv-1a over 8-byte words), chained from seed
+uint64_t ResultCache::hashBytes(const void* data, size_t size, uint64_t seed) {
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = seed ^ 0xcbf29ce484222325ULL;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+    return mix(hash ^ size);
+}
+
+// 64-bit hash of an image's geometry, type and pixels
+uint64_t ResultCache::hashImage(const cv::Mat& image) {
+    int header[3] = {image.rows, image.cols, image.type()};
+    uint64_t hash = hashBytes(header, sizeof(header));
+
+    // rows of a view are not contiguous, so hash them one by one
+    size_t row_bytes = image.cols * image.elemSize();
+    for (int y = 0; y < image.rows; ++y) {
+        hash = hashBytes(image.ptr(y), row_bytes, hash);
+    }
+    return hash;
+}
+
+// mix value into a running hash
+uint64_t ResultCache::combine(uint64_t seed, uint64_t value) {
+    return mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
@@ -0,0 +1,83 @@
+#include "spsc_queue.hpp"
+#include <algorithm>
+
+// constructor
+SpscQueue::SpscQueue(size_t capacity)
+    : slots_(std::max<size_t>(capacity, 1)), head_(0), tail_(0), waiters_(0) {
+}
+
+// push an item (producer side)
+bool SpscQueue::tryPush(size_t item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+        return false;
+    }
+    slots_[tail % slots_.size()] = item;
+
+    // publishes the slot to the consumer
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// pop the oldest item (consumer side)
+bool SpscQueue::tryPop(size_t& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    item = slots_[head % slots_.size()];
+
+    // hands the slot back to the producer
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// push an item, sleeping while the queue is full
+bool SpscQueue::push(size_t item, const std::atomic<bool>& cancelled) {
+    while (!tryPush(item)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1);
+        changed_.wait(lock, [&]() {
+            return cancelled.load() || tail_.load() - head_.load() < slots_.size();
+        });
+        waiters_.fetch_sub(1);
+        if (cancelled.load()) {
+            return false;
+        }
+    }
+    notifyWaiters();
+    return true;
+}
+
+// pop the oldest item, sleeping while the queue is empty
+bool SpscQueue::pop(size_t& item, const std::atomic<bool>& cancelled) {
+    while (!tryPop(item)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1);
+        changed_.wait(lock, [&]() { return cancelled.load() || tail_.load() != head_.load(); });
+        waiters_.fetch_sub(1);
+        if (cancelled.load()) {
+            return false;
+        }
+    }
+    notifyWaiters();
+    return true;
+}
+
+// wake the other side only if it sleeps: a sleeper counts itself before it checks the
+// queue, and the fence orders the push or pop before the count is read, so either the
+// sleeper sees the change or this sees the sleeper
+void SpscQueue::notifyWaiters() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+        wake();
+    }
+}
+
+// wake both sides (the change happened before the mutex is taken, so no wake-up is lost)
+void SpscQueue::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    changed_.notify_all();
+}
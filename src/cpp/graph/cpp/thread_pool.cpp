@@ -0,0 +1,129 @@
+#include "thread_pool.hpp"
+#include "buffer_pool.hpp"
+#include <algorithm>
+
+// constructor
+ThreadPool::ThreadPool(size_t num_threads) : stopping_(false) {
+    if (num_threads == 0) {
+        // the calling thread works too, so leave one hardware thread for it
+        size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+        num_threads = hardware_threads - 1;
+    }
+
+    workers_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+// destructor joins all workers
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+// run task(0) .. task(count - 1) on the workers and the calling thread
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    // nothing to share, run directly on the calling thread
+    if (count == 1 || workers_.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->task = task;
+    job->count = count;
+    job->pooled = BufferPool::isThreadPooled();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(job);
+    }
+    wake_.notify_all();
+
+    // the caller helps instead of blocking, which also makes nested calls safe
+    runTasks(*job);
+
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->done.wait(lock, [&job]() { return job->finished.load() == job->count; });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find(jobs_.begin(), jobs_.end(), job);
+        if (it != jobs_.end()) {
+            jobs_.erase(it);
+        }
+    }
+
+    if (job->error) {
+        std::rethrow_exception(job->error);
+    }
+}
+
+// main loop of every worker thread
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+
+            if (stopping_) {
+                return;
+            }
+
+            job = jobs_.front();
+
+            // all tasks of this job are claimed, drop it from the queue
+            if (job->next_index.load() >= job->count) {
+                jobs_.pop_front();
+                continue;
+            }
+        }
+
+        runTasks(*job);
+    }
+}
+
+// claim and run tasks of a job until none are left
+void ThreadPool::runTasks(Job& job) {
+    // tasks allocate like the thread that handed them out
+    BufferPoolThreadScope pooled(job.pooled && !BufferPool::isThreadPooled());
+
+    while (true) {
+        size_t index = job.next_index.fetch_add(1);
+        if (index >= job.count) {
+            return;
+        }
+
+        try {
+            job.task(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (!job.error) {
+                job.error = std::current_exception();
+            }
+        }
+
+        // the last finished task wakes the caller
+        if (job.finished.fetch_add(1) + 1 == job.count) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.done.notify_all();
+        }
+    }
+}
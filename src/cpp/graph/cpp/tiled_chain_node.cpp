@@ -0,0 +1,148 @@
+#include "tiled_chain_node.hpp"
+#include "fused_pointwise_node.hpp"
+#include <stdexcept>
+
+// constructor
+TiledChainNode::TiledChainNode(const std::vector<GraphNode*>& stages, int tile_size,
+                               ThreadPool* thread_pool, bool fuse_pointwise)
+    : GraphNode(joinNodeIds(stages), "tiled_chain"), tile_size_(tile_size), thread_pool_(thread_pool) {
+    if (stages.empty()) {
+        throw std::runtime_error("tiled chain node needs at least one stage");
+    }
+    if (tile_size_ <= 0) {
+        throw std::runtime_error("tile size must be positive: " + getId());
+    }
+
+    // the chain changes pixels anywhere one of its stages does
+    ROI roi;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        if (!canTile(stages[i])) {
+            throw std::runtime_error("node cannot be executed in tiles: " + stages[i]->getId());
+        }
+        roi = ROITools::unite(roi, stages[i]->getROI());
+
+        // a tile passes through every stage anyway, but fusing still saves passes over it
+        size_t end = i + 1;
+        if (fuse_pointwise && stages[i]->isPointwise()) {
+            while (end < stages.size() && stages[end]->isPointwise() &&
+                   ROITools::isSame(stages[end]->getROI(), stages[i]->getROI())) {
+                ++end;
+            }
+        }
+
+        if (end - i > 1) {
+            auto fused = std::make_shared<FusedPointwiseNode>(
+                std::vector<GraphNode*>(stages.begin() + i, stages.begin() + end));
+            stages_.push_back(fused.get());
+            fused_.push_back(std::move(fused));
+            i = end - 1;
+        } else {
+            stages_.push_back(stages[i]);
+        }
+    }
+    setROI(roi);
+}
+
+// check if a node can be a stage of a tiled chain
+bool TiledChainNode::canTile(const GraphNode* node) {
+    // filters on a partial roi take the floating-point path, whose rounding depends on
+    // the extent of the roi, so only pointwise stages may have one
+    return node->isLocal() && (node->isPointwise() || node->getROI().full_image);
+}
+
+// execute method - runs the chain over the whole image
+cv::Mat TiledChainNode::execute(const std::vector<cv::Mat>& inputs, 
+                                const ROI& roi, 
+                                const std::map<std::string, double>& parameters) {
+    (void)roi;
+    (void)parameters;
+
+    if (inputs.size() != 1) {
+        throw std::runtime_error("tiled chain node requires exactly one input image");
+    }
+    return executeTiles(inputs[0], ROI(0, 0, inputs[0].cols, inputs[0].rows));
+}
+
+// execute method - runs the chain over the tiles covering the region
+cv::Mat TiledChainNode::executeRegion(cv::Mat& input, 
+                                      const ROI& roi, 
+                                      const ROI& region, 
+                                      const std::map<std::string, double>& parameters) {
+    (void)roi;
+    (void)parameters;
+
+    return executeTiles(input, ROITools::clip(region, input.size()));
+}
+
+// region read by the first stage to produce output_region of the last one
+ROI TiledChainNode::getRequiredRegion(const ROI& output_region) const {
+    ROI region = output_region;
+    for (auto it = stages_.rbegin(); it != stages_.rend(); ++it) {
+        region = (*it)->getRequiredRegion(region);
+    }
+    return region;
+}
+
+// the signatures of the stages
+std::string TiledChainNode::getSignature() const {
+    std::string signature;
+    for (const auto* stage : stages_) {
+        signature += stage->getSignature() + ">";
+    }
+    return signature;
+}
+
+// compute region of the result (clipped to the image) tile by tile
+cv::Mat TiledChainNode::executeTiles(const cv::Mat& input, const ROI& region) const {
+    if (ROITools::isEmpty(region)) {
+        return input;
+    }
+
+    // pixels outside the region are never read, so they are left uninitialized
+    cv::Mat output(input.size(), input.type());
+
+    int tile_cols = (region.width + tile_size_ - 1) / tile_size_;
+    int tile_rows = (region.height + tile_size_ - 1) / tile_size_;
+    auto run_tile = [&](size_t index) {
+        int tx = static_cast<int>(index % tile_cols) * tile_size_;
+        int ty = static_cast<int>(index / tile_cols) * tile_size_;
+        ROI tile(region.x + tx, region.y + ty,
+                 std::min(tile_size_, region.width - tx), std::min(tile_size_, region.height - ty));
+        executeTile(input, tile, output);
+    };
+
+    size_t tile_count = static_cast<size_t>(tile_cols) * tile_rows;
+    if (thread_pool_) {
+        thread_pool_->parallelFor(tile_count, run_tile);
+    } else {
+        for (size_t i = 0; i < tile_count; ++i) {
+            run_tile(i);
+        }
+    }
+    return output;
+}
+
+// run the chain on one tile of the result and copy it into output
+void TiledChainNode::executeTile(const cv::Mat& input, const ROI& tile, cv::Mat& output) const {
+    // grow the tile backwards into the region each stage has to produce
+    std::vector<ROI> regions(stages_.size());
+    regions.back() = tile;
+    for (size_t i = stages_.size() - 1; i > 0; --i) {
+        regions[i - 1] = ROITools::clip(stages_[i]->getRequiredRegion(regions[i]), input.size());
+    }
+    ROI source = ROITools::clip(stages_.front()->getRequiredRegion(regions.front()), input.size());
+
+    // the halo reaches the image border exactly where the stages would mirror it,
+    // so running the stages on a standalone copy of the source region is exact
+    cv::Mat buffer = ROITools::extractROI(input, source).clone();
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        GraphNode* stage = stages_[i];
+        buffer = stage->executeRegion(buffer,
+                                      ROITools::translate(stage->getROI(), -source.x, -source.y),
+                                      ROITools::translate(regions[i], -source.x, -source.y),
+                                      stage->getParameters());
+    }
+
+    ROITools::extractROI(buffer, ROITools::translate(tile, -source.x, -source.y))
+        .copyTo(ROITools::extractROI(output, tile));
+}
@@ -0,0 +1,29 @@
+#include "work_stealing_queue.hpp"
+
+// push a task (owner side)
+void WorkStealingQueue::push(size_t task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(task);
+}
+
+// pop the most recently pushed task (owner side)
+bool WorkStealingQueue::pop(size_t& task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty()) {
+        return false;
+    }
+    task = tasks_.back();
+    tasks_.pop_back();
+    return true;
+}
+
+// take the oldest task (thief side)
+bool WorkStealingQueue::steal(size_t& task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty()) {
+        return false;
+    }
+    task = tasks_.front();
+    tasks_.pop_front();
+    return true;
+}
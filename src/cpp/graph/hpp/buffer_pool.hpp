@@ -0,0 +1,93 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// cv::Mat allocator that recycles freed image buffers by byte size, so frames of
+// the same geometry reuse the buffers allocated for the first frame; only threads inside
+// a pooled scope use it, every other allocation goes to the allocator it replaced
+class BufferPool : public cv::MatAllocator {
+private:
+    // freed buffers (with their UMatData headers) of one byte size waiting for reuse
+    struct SizeClass {
+        std::vector<cv::UMatData*> buffers;
+        std::list<size_t>::iterator recency;          // position in lru_
+    };
+
+    mutable std::unordered_map<size_t, SizeClass> free_buffers_;
+    mutable std::list<size_t> lru_;                   // cached byte sizes, most recently used first
+    mutable std::mutex mutex_;
+    mutable size_t cached_bytes_;                     // bytes held in free_buffers_
+    size_t capacity_;                                 // most bytes cached before evicting
+    mutable std::atomic<size_t> fresh_allocations_;   // buffers that had to be allocated
+    mutable std::atomic<size_t> reused_allocations_;  // buffers served from the pool
+
+    BufferPool();
+
+    // free cached buffers of the least recently used sizes until the cache fits its capacity
+    void evict() const;
+
+    // free a cached buffer and its header
+    static void destroy(cv::UMatData* u);
+
+public:
+    // process-wide pool; never destroyed, because pooled mats may outlive any executor
+    static BufferPool& instance();
+
+    // cv::MatAllocator interface
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    // number of buffers allocated from the heap so far (test hook: constant after warm-up)
+    size_t getFreshAllocationCount() const { return fresh_allocations_.load(); }
+
+    // number of allocations served from recycled buffers so far
+    size_t getReusedAllocationCount() const { return reused_allocations_.load(); }
+
+    // bytes currently cached for reuse
+    size_t getCachedBytes() const;
+
+    // most bytes kept for reuse (default 512 MB); freed buffers beyond it release the
+    // sizes used least recently
+    size_t getCapacity() const;
+    void setCapacity(size_t bytes);
+
+    // free every cached buffer (e.g. after the frame geometry changed)
+    void trim();
+
+    // whether the calling thread allocates through the pool
+    static bool isThreadPooled();
+};
+
+// routes the calling thread's cv::Mat allocations through the buffer pool while at least
+// one guard is alive (the pool is installed as default allocator meanwhile, but other
+// threads keep allocating as before)
+class ScopedBufferPool {
+public:
+    ScopedBufferPool();
+    ~ScopedBufferPool();
+
+    ScopedBufferPool(const ScopedBufferPool&) = delete;
+    ScopedBufferPool& operator=(const ScopedBufferPool&) = delete;
+};
+
+// routes the calling thread's allocations through the pool while a ScopedBufferPool is
+// alive on another thread (worker threads of a pooled run)
+class BufferPoolThreadScope {
+private:
+    bool enabled_;
+
+public:
+    explicit BufferPoolThreadScope(bool enabled = true);
+    ~BufferPoolThreadScope();
+
+    BufferPoolThreadScope(const BufferPoolThreadScope&) = delete;
+    BufferPoolThreadScope& operator=(const BufferPoolThreadScope&) = delete;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// cost and reject rate of a check node over its most recent runs, used to run cheap,
+// selective checks first (like a query optimizer orders predicates)
+class CheckStatistics {
+private:
+    std::vector<double> costs_;   // ring buffer of run times in milliseconds
+    std::vector<bool> failures_;  // ring buffer of outcomes (true = rejected)
+    size_t next_;                 // slot the next sample overwrites
+    size_t count_;                // samples in the window
+    double cost_sum_;
+    size_t failure_count_;
+
+public:
+    // constructor (window = number of most recent runs kept)
+    explicit CheckStatistics(size_t window = 64);
+
+    // record one run of the check
+    void record(double cost_ms, bool failed);
+
+    // number of runs in the window
+    size_t getSampleCount() const { return count_; }
+
+    // average run time in milliseconds (0 without samples)
+    double getMeanCost() const;
+
+    // fraction of runs that rejected the frame (0 without samples)
+    double getRejectRate() const;
+
+    // expected time spent per rejected frame, lower runs first: 0 while unmeasured
+    // (so new checks are measured early), infinite for checks that never reject
+    double getRank() const;
+};
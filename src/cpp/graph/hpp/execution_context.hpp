@@ -0,0 +1,141 @@
+#pragma once
+
+#include "graph_node.hpp"
+#include "work_stealing_queue.hpp"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// statistics of one run of a graph
+struct ExecutionStats {
+    int total_nodes = 0;
+    int executed_nodes = 0;
+    std::chrono::milliseconds execution_time{0};
+    size_t peak_image_bytes = 0;          // most image bytes held by result slots at once
+    size_t fresh_buffer_allocations = 0;  // image buffers taken from the heap (0 once warmed up;
+                                          // counted process-wide, so concurrent runs add up)
+    size_t cache_hits = 0;                // results served from the memoization cache
+    size_t cache_misses = 0;              // cacheable results that had to be computed
+    size_t reused_nodes = 0;              // results kept from the previous run (incremental mode)
+    size_t skipped_nodes = 0;             // nodes switched off by a failed predicate or a rejection
+    bool rejected = false;                // a predicate with "reject" set failed
+    NodeId rejected_by;                   // id of that predicate
+    size_t shed_nodes = 0;                // optional nodes passed over to meet the deadline
+    bool degraded = false;                // some optional node was shed
+};
+
+// per-frame state of running a loaded graph: result slots, buffer accounting, counters and
+// injected input images; the executor and its graph stay untouched while a frame runs, so
+// one executor can run many contexts at the same time from different threads (each
+// context runs one frame at a time, and all but one capture their outputs)
+class ExecutionContext {
+private:
+    friend class GraphExecutor;
+    
+    // an image given to an input node instead of the file it would load
+    struct InjectedInput {
+        cv::Mat image;
+        bool changed = true;   // set since the last run (recomputed in incremental mode)
+    };
+    
+    size_t plan_version_;                                // plan the slots are sized for (0 = none)
+    size_t result_slot_;                                 // slot returned as the final result
+    std::vector<cv::Mat> node_results_;                  // result slot per plan node
+    std::vector<std::atomic<uint8_t>> released_;         // per slot, result was valid when released
+    std::vector<std::atomic<uint8_t>> left_empty_;       // per slot, finished this run without a result
+    std::vector<std::vector<cv::Mat>> node_inputs_;      // reusable input lists per plan node
+    std::vector<uint64_t> node_keys_;                    // cache key per slot in the current run
+    std::vector<bool> run_node_;                         // per slot, node runs in the current run
+    std::vector<double> node_priority_;                  // per slot, lower runs first among ready nodes
+    std::vector<double> node_rank_;                      // per slot, upward rank (ms), higher runs first among equals
+    bool has_priorities_;                                // ready nodes are ordered by more than plan order
+    std::unordered_map<NodeId, InjectedInput> inputs_;   // images for input nodes, by node id
+    std::vector<const InjectedInput*> injected_;         // per slot, the image replacing its source (null = none)
+    bool inputs_resolved_;                               // injected_ matches inputs_ and the plan
+    bool capture_outputs_;                               // output nodes pass their image on unsaved
+    
+    // deadline: optional nodes are shed once the work left would overrun it
+    std::chrono::steady_clock::time_point deadline_;     // fixed deadline (max = none)
+    std::chrono::milliseconds time_budget_;              // deadline counted from each run's start (0 = none)
+    std::chrono::steady_clock::time_point run_deadline_; // deadline of the current run (max = none)
+    std::vector<double> node_cost_;                      // per slot, smoothed cost (ms) when the run began
+    bool measure_costs_;                                 // computed nodes' costs are recorded this run
+    std::atomic<int64_t> remaining_required_us_;         // estimated cost of the required nodes still to run
+    std::vector<uint8_t> node_shed_;                     // per slot, input passed on unprocessed this run
+    
+    // input geometry: pooled buffers of an old frame size are of no use for the new one
+    std::vector<std::pair<cv::Size, int>> source_geometry_; // per source slot, size and type last loaded
+    std::atomic<bool> geometry_changed_;                 // some source changed geometry this run
+    
+    // scratch of the schedulers, sized once per plan and reused by every run
+    std::vector<uint8_t> out_of_date_;                   // per slot, result recomputed this run
+    std::vector<std::atomic<size_t>> remaining_inputs_;  // per slot, producers still to finish
+    std::vector<size_t> ready_nodes_;                    // heap of ready nodes (list scheduler)
+    std::vector<size_t> level_order_;                    // a level in dispatch order (parallel mode)
+    std::vector<double> finish_times_;                   // per slot, projected finish (concurrency estimate)
+    std::vector<WorkStealingQueue> work_queues_;         // per worker, ready nodes (dataflow mode)
+    
+    // buffer liveness: a result slot is released once its last consumer has run
+    std::vector<std::atomic<size_t>> pending_consumers_; // consumers still to run, per slot
+    std::mutex memory_mutex_;                            // guards the resident byte accounting
+    std::unordered_map<const uchar*, size_t> buffer_refs_; // result slots referencing each buffer
+    size_t resident_bytes_;                              // image bytes currently held by result slots
+    size_t peak_resident_bytes_;                         // high-water mark of resident_bytes_
+    
+    // counters of the current run
+    std::mutex progress_mutex_;                          // serializes progress callbacks
+    int started_nodes_;                                  // nodes started (for progress reporting)
+    std::atomic<int> executed_nodes_;                    // nodes computed
+    std::atomic<size_t> cache_hits_;                     // results served from the cache
+    std::atomic<size_t> cache_misses_;                   // cacheable results computed
+    std::atomic<size_t> reused_nodes_;                   // results kept from the previous run
+    std::atomic<size_t> skipped_nodes_;                  // nodes switched off
+    std::atomic<bool> rejected_;                         // a rejecting predicate failed
+    NodeId rejected_by_;                                 // the predicate that rejected the frame
+    std::atomic<size_t> shed_nodes_;                     // optional nodes shed
+    ExecutionStats stats_;                               // statistics of the last finished run
+    
+public:
+    // constructor (slots are sized by the executor on the first run)
+    ExecutionContext();
+    
+    ExecutionContext(const ExecutionContext&) = delete;
+    ExecutionContext& operator=(const ExecutionContext&) = delete;
+    
+    // run the input node input_id on image instead of loading its file (the image is
+    // shared, never written)
+    void setInput(const NodeId& input_id, const cv::Mat& image);
+    
+    // go back to loading every input node's file
+    void clearInputs() { inputs_.clear(); inputs_resolved_ = false; }
+    
+    // keep what output nodes would save in the context instead of writing their files
+    // (the caller saves getResult() itself, e.g. to a path of its own per frame)
+    void setOutputCapture(bool enabled) { capture_outputs_ = enabled; }
+    
+    // give the following runs a fixed deadline; optional nodes are shed (their input is
+    // passed on) once the measured cost of the work left would overrun it
+    void setDeadline(std::chrono::steady_clock::time_point deadline) { deadline_ = deadline; }
+    
+    // give every run a deadline of budget after its start (0 = none)
+    void setTimeBudget(std::chrono::milliseconds budget) { time_budget_ = budget; }
+    
+    // run everything regardless of time
+    void clearDeadline();
+    
+    // get the final result of the last run (empty if the frame was rejected or the
+    // result node skipped)
+    cv::Mat getResult() const;
+    
+    // get the statistics of the last run
+    const ExecutionStats& getStats() const { return stats_; }
+    
+    // drop every result slot (the next run recomputes everything)
+    void clearResults();
+};
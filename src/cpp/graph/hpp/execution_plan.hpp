@@ -0,0 +1,48 @@
+#pragma once
+
+#include "graph.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+// optimizations applied when compiling a plan
+struct CompileOptions {
+    bool fuse_pointwise = false;     // replace pointwise chains by one FusedPointwiseNode
+    bool propagate_regions = false;  // clip local nodes to the region downstream reads
+    int tile_size = 0;               // run chains of local nodes tile by tile (0 = untiled)
+    ThreadPool* thread_pool = nullptr; // spreads the tiles across cores (null = one thread)
+};
+
+// immutable, index-based form of a graph, compiled once before execution
+// (node i in the plan writes its result into result slot i)
+struct ExecutionPlan {
+    // marker for "no slot"
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::vector<GraphNode*> nodes;                   // nodes in topological order
+    std::vector<std::vector<GraphNode*>> members;    // per node, the graph nodes it stands for
+    std::vector<std::vector<size_t>> input_slots;    // per node, result slots feeding its inputs (connection order)
+    std::vector<std::vector<size_t>> producers;      // per node, distinct nodes it reads from
+    std::vector<std::vector<size_t>> consumers;      // per node, distinct nodes reading its result
+    std::vector<bool> sole_consumer;                 // per node, single input whose only reader is this node
+    std::vector<bool> is_output;                     // per node, an output node (its result may be captured)
+    std::vector<bool> rejects_frame;                 // per node, a predicate that rejects the frame when it fails
+    std::map<NodeId, size_t> sources;                // source nodes by id (where injected inputs go)
+    std::vector<std::vector<size_t>> levels;         // execution levels as node indices
+    std::vector<ROI> required_regions;               // per node, region of its result read downstream
+    std::vector<uint64_t> signature_keys;            // per node, hash of its signature and required region
+    size_t result_slot = npos;                       // slot returned as the final result
+    std::vector<std::shared_ptr<GraphNode>> fused_nodes; // nodes created by fusion or tiling (owned by the plan)
+
+    // compile a validated, acyclic graph into a plan
+    static ExecutionPlan compile(Graph& graph, const CompileOptions& options = CompileOptions());
+
+    // number of nodes in the plan
+    size_t size() const { return nodes.size(); }
+
+    // check if the plan has no nodes
+    bool empty() const { return nodes.empty(); }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "graph_node.hpp"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// node replacing a chain of pointwise nodes (brightness, contrast) that share one roi;
+// for 8-bit images the whole chain is composed into a single 256-entry lookup table,
+// so N passes over memory become one
+class FusedPointwiseNode : public GraphNode {
+private:
+    std::vector<GraphNode*> stages_;  // fused nodes in execution order (owned by the graph)
+    cv::Mat lut_;                     // composed 8-bit lookup table
+
+    // run the stages one after another (fallback for non 8-bit images)
+    cv::Mat executeStages(const cv::Mat& input) const;
+
+public:
+    // constructor (stages must be pointwise and share the same roi)
+    explicit FusedPointwiseNode(const std::vector<GraphNode*>& stages);
+
+    // destructor
+    ~FusedPointwiseNode() override = default;
+
+    // execute method - applies the whole chain
+    cv::Mat execute(const std::vector<cv::Mat>& inputs, 
+                   const ROI& roi, 
+                   const std::map<std::string, double>& parameters) override;
+
+    // execute method - applies the whole chain inside the input buffer
+    cv::Mat executeInPlace(cv::Mat& input, 
+                           const ROI& roi, 
+                           const std::map<std::string, double>& parameters) override;
+
+    // the lookup table can be applied in place
+    bool supportsInPlace() const override { return true; }
+
+    // a fused chain is still pointwise
+    bool isPointwise() const override { return true; }
+
+    // pointwise nodes can always run on part of their roi
+    bool isLocal() const override { return true; }
+
+    // every output pixel reads only the same input pixel
+    ROI getRequiredRegion(const ROI& output_region) const override { return output_region; }
+
+    // the signatures of the fused stages
+    std::string getSignature() const override;
+
+    // get the fused nodes
+    const std::vector<GraphNode*>& getStages() const { return stages_; }
+};
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include "graph_node.hpp"
 
@@ -18,6 +19,8 @@ struct Connection {
     NodeId to_node;
     int to_port;
     
+    Connection() : from_port(0), to_port(0) {}
+    
     Connection(const NodeId& from, int from_p, const NodeId& to, int to_p)
         : from_node(from), from_port(from_p), to_node(to), to_port(to_p) {}
 };
@@ -29,12 +32,39 @@ private:
     std::vector<Connection> connections_; // connections between nodes
     NodeId input_node_id_;             // id of the input node
     NodeId output_node_id_;            // id of the output node
-    ExecutionLevels execution_levels_; // levels for parallel execution
+    
+    // connection indices by target / source node, so lookups cost O(degree)
+    std::unordered_map<NodeId, std::vector<size_t>> incoming_index_;
+    std::unordered_map<NodeId, std::vector<size_t>> outgoing_index_;
+    
+    // linked node pairs ("from\0to"), used to skip duplicate links in O(1)
+    std::unordered_set<std::string> linked_pairs_;
+    
+    // execution levels are maintained lazily: single edge insertions update
+    // node depths incrementally, everything else marks the levels dirty and
+    // the next getExecutionLevels() reruns the sort once
+    mutable ExecutionLevels execution_levels_;               // levels for parallel execution
+    mutable std::unordered_map<NodeId, size_t> node_depths_; // level index per node
+    mutable bool levels_dirty_;        // depths must be recomputed by a full sort
+    mutable bool levels_stale_;        // depths are valid, levels must be regrouped
+    int update_depth_;                 // nesting of beginUpdate()/endUpdate()
 
     // helper function for cycle detection using dfs
     bool hasCyclesDFS(const NodeId& node_id, 
                      std::unordered_set<NodeId>& visited,
                      std::unordered_set<NodeId>& recursion_stack) const;
+    
+    // link two existing nodes, returns false if they were already linked
+    bool linkNodes(GraphNode* from_node, GraphNode* to_node);
+    
+    // raise depths after the edge from -> to was added (marks levels dirty on a cycle)
+    void propagateDepth(const NodeId& from_node_id, const NodeId& to_node_id);
+    
+    // rebuild the connection indices after connections were removed
+    void rebuildConnectionIndex();
+    
+    // bring execution levels up to date
+    void refreshExecutionLevels() const;
 
 public:
     // constructor
@@ -111,12 +141,18 @@ public:
     // perform topological sort to get execution levels
     ExecutionLevels topologicalSort() const;
     
-    // get execution levels (cached result of topological sort)
-    const ExecutionLevels& getExecutionLevels() const { return execution_levels_; }
+    // get execution levels (cached result of topological sort, refreshed if needed)
+    const ExecutionLevels& getExecutionLevels() const;
     
-    // update execution levels (call after graph changes)
+    // force a full recomputation of the execution levels
     void updateExecutionLevels();
     
+    // start a batch of edits: levels are not maintained until the matching endUpdate()
+    void beginUpdate();
+    
+    // finish a batch of edits (the levels are sorted once, on next use)
+    void endUpdate();
+    
     // clear all nodes
     void clear();
 }; 
\ No newline at end of file
@@ -2,23 +2,141 @@
 
 #include "graph.hpp"
 #include "graph_node_factory.hpp"
+#include "execution_plan.hpp"
+#include "execution_context.hpp"
+#include "thread_pool.hpp"
+#include "buffer_pool.hpp"
+#include "result_cache.hpp"
+#include "check_statistics.hpp"
+#include "work_stealing_queue.hpp"
+#include "spsc_queue.hpp"
+#include "kernel_threads.hpp"
 #include "bindings/hpp/pipeline_reader.hpp"
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
-// executor class for running graph-based pipelines
+// how the executor schedules the nodes of a graph
+enum class ExecutionMode {
+    Sequential,  // one node after another in topological order
+    Parallel,    // all nodes of an execution level at the same time
+    Dataflow     // each node as soon as its last input is ready (work stealing)
+};
+
+// how many threads OpenCV's own kernels (blur, sobel, canny, ...) may use while the graph runs
+enum class KernelThreading {
+    Adaptive,    // the cores divided by the nodes running at the same time (see KernelThreadBudget)
+    Serial,      // always one thread per kernel, all parallelism comes from the graph
+    Unmanaged    // OpenCV's own setting, left alone (kernels and nodes compete for the cores)
+};
+
+// how executeStream pipelines frames through the graph
+struct StreamOptions {
+    size_t stage_count = 0;      // pipeline stages (0 = one per hardware thread; at most one per node)
+    size_t queue_capacity = 4;   // frames waiting between two stages at most
+    bool pin_threads = true;     // pin each stage thread to its own core (linux only)
+    std::chrono::milliseconds time_budget{0}; // per frame from its read (0 = none), see setTimeBudget
+};
+
+// statistics of a streaming run
+struct StreamStats {
+    size_t frames = 0;                             // frames read and handed over
+    std::chrono::milliseconds total_time{0};       // wall time of the whole stream
+    double throughput = 0.0;                       // frames per second
+    double mean_latency_ms = 0.0;                  // from reading a frame to handing it over
+    double max_latency_ms = 0.0;
+    std::vector<double> stage_costs_ms;            // mean busy time per frame, per stage
+    std::vector<std::vector<NodeId>> stage_nodes;  // plan nodes run by each stage
+};
+
+// one image of a batch: the file to read and where to save the graph's result
+struct BatchItem {
+    std::string input_path;
+    std::string output_path;
+};
+
+// how executeBatch spreads a batch over threads
+struct BatchOptions {
+    size_t parallel_images = 0;  // images processed at the same time (0 = one per hardware thread)
+    size_t prefetch = 4;         // images decoded ahead of the workers
+    size_t write_behind = 4;     // finished images waiting to be saved at most
+    NodeId input_id;             // input node fed with the images (empty = the graph's only one)
+    std::chrono::milliseconds time_budget{0}; // per image from its start (0 = none), see setTimeBudget
+};
+
+// statistics of a batch run
+struct BatchStats {
+    size_t images = 0;                           // images in the batch
+    size_t saved = 0;                            // results written
+    size_t rejected = 0;                         // rejected by a check, nothing written
+    size_t failed = 0;                           // could not be read, processed or written
+    std::chrono::milliseconds total_time{0};     // wall time of the whole batch
+    double throughput = 0.0;                     // images per second
+    std::vector<std::pair<std::string, std::string>> failures; // input path and error per failure
+};
+
+// executor class for running graph-based pipelines; the loaded graph and its plan are
+// shared by every run, while per-frame state lives in an ExecutionContext, so the const
+// execute(context) overloads may run concurrently (configuration changes may not)
 class GraphExecutor {
 private:
     Graph graph_;
-    std::map<NodeId, cv::Mat> node_results_;  // cache for node execution results
+    ExecutionPlan plan_;                      // compiled, index-based form of graph_
+    size_t plan_version_;                     // bumped by every compile, contexts follow it
+    bool writes_files_;                       // the plan has output nodes that save files
+    mutable std::atomic<int> file_writers_;   // runs letting output nodes save right now (0 or 1)
+    ExecutionMode mode_;                      // scheduling strategy
+    size_t thread_count_;                     // worker threads (0 = hardware default)
+    mutable std::unique_ptr<ThreadPool> thread_pool_; // persistent workers for parallel mode
+    mutable std::mutex pool_mutex_;           // guards the lazy creation of thread_pool_
+    bool use_buffer_pool_;                    // recycle image buffers across runs
+    KernelThreading kernel_threading_;        // thread budget of OpenCV's kernels
+    CompileOptions compile_options_;          // optimizations applied by prepare()
+    ExecutionContext default_context_;        // frame state of execute() without a context
+    
+    // memoization across runs: results keyed by node configuration and input content
+    mutable ResultCache result_cache_;                   // disabled until given a budget
+    
+    // incremental re-execution: only nodes whose configuration (or an upstream one) changed
+    // are recomputed; results stay in their slots between runs where a consumer may need
+    // them again without its producer changing (it was tuned before, or it runs every time)
+    bool incremental_;                                   // keep results across runs
+    std::unordered_set<NodeId> tuned_nodes_;             // nodes changed since the graph was loaded
+    std::vector<uint8_t> retained_;                      // per slot, result kept between runs (fixed per plan)
+    
+    // check ordering: rejecting predicates are measured over a sliding window and the ready
+    // nodes of a run are ordered so cheap, selective checks run first
+    bool order_checks_;                                  // reorder independent checks by rank
+    mutable std::mutex check_mutex_;                     // guards check_stats_
+    mutable std::vector<CheckStatistics> check_stats_;   // per slot (measured for rejecting predicates)
+    
+    // critical-path scheduling: computed nodes' costs are smoothed over the runs that use
+    // them (also the basis of deadline projections and adaptive kernel widths), and ready
+    // nodes with the longest measured path to the end of the graph run first
+    bool critical_path_;                                 // order ready nodes by upward rank
+    mutable std::vector<std::atomic<double>> node_costs_; // per slot, smoothed cost (ms, 0 = unmeasured)
     
 public:
+    // statistics of a run (defined next to the execution context that collects them)
+    using ExecutionStats = ::ExecutionStats;
+    
+    // tile edge length used by sea_vision --tiled unless --tile-size gives another
+    static constexpr int default_tile_size = 512;
+    
     // constructor
     GraphExecutor();
     
-    // destructor
-    ~GraphExecutor() = default;
+    // destructor (frees the buffers pooled for its runs)
+    ~GraphExecutor();
     
     // load graph from JSON file
     void loadGraph(const std::string& json_file);
@@ -26,12 +144,112 @@ public:
     // load graph from GraphConfig
     void loadGraph(const GraphConfig& config);
     
-    // execute the graph sequentially
+    // compile the loaded graph into an execution plan (called by loadGraph)
+    void prepare();
+    
+    // apply node changes made through GraphNode::setParameters/setROI since the last
+    // compile (execute() does this itself; call it before running contexts concurrently)
+    void update();
+    
+    // set the scheduling strategy
+    void setExecutionMode(ExecutionMode mode) { mode_ = mode; }
+    
+    // get the scheduling strategy
+    ExecutionMode getExecutionMode() const { return mode_; }
+    
+    // set the number of worker threads used in parallel mode (0 = hardware default)
+    void setThreadCount(size_t thread_count);
+    
+    // choose how many threads OpenCV's kernels may use next to the graph's own workers
+    // (adaptive by default)
+    void setKernelThreading(KernelThreading threading) { kernel_threading_ = threading; }
+    
+    // get how many threads OpenCV's kernels may use
+    KernelThreading getKernelThreading() const { return kernel_threading_; }
+    
+    // enable or disable recycling of image buffers through the BufferPool
+    void setBufferPoolEnabled(bool enabled) { use_buffer_pool_ = enabled; }
+    
+    // enable or disable fusion of pointwise chains (recompiles a loaded graph)
+    void setPointwiseFusionEnabled(bool enabled);
+    
+    // enable or disable clipping nodes to the region downstream reads (recompiles a loaded graph)
+    void setRegionPropagationEnabled(bool enabled);
+    
+    // keep results across runs in a memoization cache of at most budget_bytes bytes,
+    // evicting the least recently used (0 = disabled, the default)
+    void setResultCacheBudget(size_t budget_bytes);
+    
+    // drop every memoized result
+    void clearResultCache();
+    
+    // run chains of blur/sharpen/brightness/contrast nodes tile by tile on the thread pool,
+    // with tiles of tile_size x tile_size pixels (0 = untiled; recompiles a loaded graph)
+    void setTileSize(int tile_size);
+    
+    // recompute only the nodes changed through GraphNode::setParameters/setROI and their
+    // downstream consumers (off by default); the result, the inputs of nodes with side
+    // effects and the inputs of nodes changed before are kept between runs, other
+    // intermediates are released as usual and recomputed once when a consumer needs them
+    void setIncrementalExecutionEnabled(bool enabled);
+    
+    // run independent rejecting checks in order of measured cost per rejection (on by
+    // default); reordering never changes whether a frame is rejected
+    void setCheckOrderingEnabled(bool enabled) { order_checks_ = enabled; }
+    
+    // cost and reject rate measured for a rejecting check (empty if it never ran)
+    CheckStatistics getCheckStatistics(const NodeId& node_id) const;
+    
+    // dispatch the ready node with the longest measured path to the end of the graph first
+    // (off by default: ranked dispatch goes through one shared ready queue instead of the
+    // dataflow scheduler's work stealing; reordering never changes results)
+    void setCriticalPathSchedulingEnabled(bool enabled) { critical_path_ = enabled; }
+    
+    // smoothed cost of a plan node over its computed runs, in ms (0 if never measured; costs
+    // are measured while critical path scheduling, a deadline or adaptive kernel threads
+    // under a concurrent scheduler use them)
+    double getNodeCost(const NodeId& node_id) const;
+    
+    // give every execute() run a time budget: once the measured cost of the work left would
+    // overrun it, optional nodes are shed and the run is flagged as degraded (0 = none;
+    // contexts carry their own deadline)
+    void setTimeBudget(std::chrono::milliseconds budget) { default_context_.setTimeBudget(budget); }
+    
+    // get a node of the loaded graph to tune it between runs (null if unknown)
+    GraphNode* getNode(const NodeId& node_id) { return graph_.getNode(node_id); }
+    
+    // execute the graph using the current execution mode
     cv::Mat execute();
     
     // execute the graph with progress reporting
     cv::Mat executeWithProgress(std::function<void(const std::string&, int, int)> progress_callback = nullptr);
     
+    // execute one frame with its own state (thread-safe: contexts may run concurrently,
+    // each one on one thread at a time; while a context lets output nodes save their
+    // files, runs of other contexts that would too throw instead of writing the same paths)
+    cv::Mat execute(ExecutionContext& context) const;
+    
+    // execute one frame with its own state and progress reporting (the callback is
+    // serialized per context only)
+    cv::Mat executeWithProgress(ExecutionContext& context,
+                                std::function<void(const std::string&, int, int)> progress_callback) const;
+    
+    // run a stream of frames through the graph as a pipeline: the plan is cut into stages
+    // of about equal cost (measured on the first frame), each stage runs on its own thread
+    // and hands frames to the next one through a bounded queue, so throughput approaches
+    // 1 / (cost of the slowest stage) instead of 1 / (cost of the graph). read_frame fills a
+    // context's inputs (returning false ends the stream) and runs on the calling thread;
+    // write_result takes each finished frame, in order, on the last stage's thread
+    StreamStats executeStream(const std::function<bool(ExecutionContext&)>& read_frame,
+                              const std::function<void(ExecutionContext&)>& write_result,
+                              const StreamOptions& options = StreamOptions()) const;
+    
+    // run the graph once per image of a batch, options.parallel_images images at a time,
+    // each on its own context; a reader thread decodes images ahead and the calling thread
+    // saves the results behind (output nodes do not write their own files). A failing
+    // image is recorded in the statistics and does not stop the batch
+    BatchStats executeBatch(const std::vector<BatchItem>& items, const BatchOptions& options = BatchOptions()) const;
+    
     // get the final result
     cv::Mat getResult() const;
     
@@ -39,27 +257,113 @@ public:
     void clearResults();
     
     // get execution statistics
-    struct ExecutionStats {
-        int total_nodes;
-        int executed_nodes;
-        std::chrono::milliseconds execution_time;
-    };
-    
     ExecutionStats getExecutionStats() const;
-
+    
 private:
     // build graph from configuration
     void buildGraph(const GraphConfig& config);
     
-    // execute a single node
-    cv::Mat executeNode(const NodeId& node_id);
+    // recompile the plan of a loaded graph after the compile options changed
+    void recompile();
+    
+    // check if a node changed since the plan was compiled
+    bool hasNodeChanges() const;
+    
+    // recompile after node changes, moving still valid results into the new plan
+    void recompileIncremental();
+    
+    // decide which result slots incremental runs keep
+    void updateRetainedResults();
+    
+    // slot of a plan node (ExecutionPlan::npos if the plan has no node of that id)
+    size_t findSlot(const NodeId& node_id) const;
+    
+    // size a context's slots for the current plan (dropping its results)
+    void attachContext(ExecutionContext& context) const;
+    
+    // reset the per-run state of a context and decide which nodes run
+    void beginRun(ExecutionContext& context) const;
+    
+    // fill a context's statistics at the end of a run
+    void collectStats(ExecutionContext& context, std::chrono::high_resolution_clock::time_point start_time) const;
+    
+    // free the pooled buffers once a source of the finished run changed size or type
+    void trimOnGeometryChange(ExecutionContext& context) const;
+    
+    // reset the counters and buffer accounting of a run (results are left alone)
+    void resetRunStats(ExecutionContext& context) const;
+    
+    // rank the rejecting checks by their statistics and every node by its upward rank for this run
+    void updatePriorities(ExecutionContext& context) const;
+    
+    // check if node a is dispatched before node b when both are ready (ranked checks first,
+    // then the higher upward rank, then plan order)
+    bool runsBefore(const ExecutionContext& context, size_t a, size_t b) const;
+    
+    // order nodes by priority (plan order among equals)
+    void sortByPriority(const ExecutionContext& context, std::vector<size_t>& nodes) const;
+    
+    // check if running an optional node now would make the run miss its deadline
+    bool missesDeadline(const ExecutionContext& context, size_t node_index) const;
     
-    // get input images for a node
-    std::vector<cv::Mat> getNodeInputs(const NodeId& node_id);
+    // fold a computed node's cost into its smoothed cost
+    void recordNodeCost(size_t node_index, double cost_ms) const;
+    
+    // width of the kernel thread lease for concurrency nodes running at once (0 = no lease)
+    size_t kernelWidth(size_t concurrency) const;
+    
+    // nodes expected to run at once on worker_count workers: the measured work of the run
+    // over its measured critical path (the widest level before anything was measured)
+    size_t expectedConcurrency(ExecutionContext& context, size_t worker_count) const;
+    
+    // run nodes one after another in topological order
+    void executeSequential(ExecutionContext& context,
+                           const std::function<void(const std::string&, int, int)>& progress_callback) const;
+    
+    // run the nodes of each execution level concurrently on the thread pool
+    void executeParallel(ExecutionContext& context,
+                         const std::function<void(const std::string&, int, int)>& progress_callback) const;
+    
+    // run each node as soon as all of its producers have finished
+    void executeDataflow(ExecutionContext& context,
+                         const std::function<void(const std::string&, int, int)>& progress_callback) const;
+    
+    // run nodes on worker_count workers, each taking the best ranked ready node when free
+    void executeListScheduled(ExecutionContext& context, size_t worker_count,
+                              const std::function<void(const std::string&, int, int)>& progress_callback) const;
+    
+    // report that a node is about to run (thread-safe)
+    void reportProgress(ExecutionContext& context, size_t node_index,
+                        const std::function<void(const std::string&, int, int)>& progress_callback) const;
+    
+    // get the thread pool, creating it on first use
+    ThreadPool& getThreadPool() const;
+    
+    // execute a single plan node (or take it from the cache) and store its result in its slot
+    void executeNode(ExecutionContext& context, size_t node_index) const;
+    
+    // compute a plan node's result from its inputs
+    void computeResult(ExecutionContext& context, size_t node_index) const;
+    
+    // compute a plan node's cache key and look its result up
+    bool lookupCachedResult(ExecutionContext& context, size_t node_index) const;
+    
+    // memoize a computed result (and key sources by the content they loaded)
+    void storeCachedResult(ExecutionContext& context, size_t node_index) const;
+    
+    // execute a local plan node only where its result is read downstream
+    cv::Mat executeRegion(ExecutionContext& context, size_t node_index) const;
+    
+    // account a newly stored result in the resident byte counters
+    void retainResult(ExecutionContext& context, const cv::Mat& result) const;
+    
+    // check if the next incremental run reads a result again although no node it depends
+    // on changes (a consumer of it was left without a result)
+    bool isReadAgain(const ExecutionContext& context, size_t slot) const;
+    
+    // release a result slot (unless it holds the final result, or one incremental runs keep)
+    void releaseResult(ExecutionContext& context, size_t slot) const;
     
     // validate graph before execution
     void validateGraph() const;
-    
-    // execution statistics
-    mutable ExecutionStats stats_;
-}; 
\ No newline at end of file
+};
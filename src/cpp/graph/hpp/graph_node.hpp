@@ -26,8 +26,8 @@ protected:
     InputList input_node_ids_;
     OutputList output_node_ids_;
     ROI roi_;
-    bool executed_;
-    cv::Mat result_;
+    bool dirty_;                 // configuration changed since the plan was compiled
+    bool optional_;              // may be shed when a frame runs out of time
     
 public:
     GraphNode(const NodeId& id, const std::string& type);
@@ -37,6 +37,52 @@ public:
                            const ROI& roi, 
                            const std::map<std::string, double>& parameters) = 0;
     
+    // execute on a single input buffer the caller owns exclusively (may be overwritten);
+    // only called when supportsInPlace() is true
+    virtual cv::Mat executeInPlace(cv::Mat& input, 
+                                   const ROI& roi, 
+                                   const std::map<std::string, double>& parameters);
+    
+    // execute where only the pixels inside region (clipped to the image) are read
+    // afterwards; only called when isLocal() is true, and the input is owned exclusively
+    // (may be overwritten) only if supportsInPlace() is true
+    virtual cv::Mat executeRegion(cv::Mat& input, 
+                                  const ROI& roi, 
+                                  const ROI& region, 
+                                  const std::map<std::string, double>& parameters);
+    
+    // parse and validate the node's parameters ahead of its runs (throws if they are
+    // invalid); the executor calls it whenever it compiles a changed node
+    virtual void prepare() {}
+    
+    // check if the node can reuse its input buffer for its result
+    virtual bool supportsInPlace() const { return false; }
+    
+    // check if the node maps every pixel value independently (fusable into a lookup table)
+    virtual bool isPointwise() const { return false; }
+    
+    // check if the node's roi may be clipped to the region downstream reads
+    virtual bool isLocal() const { return false; }
+    
+    // region of the input read to produce output_region of the result (default: all of it)
+    virtual ROI getRequiredRegion(const ROI& output_region) const { return ROI(0, 0, 0, 0, true); }
+    
+    // text identifying what the node computes from its inputs (type, parameters, roi);
+    // nodes with equal signatures and equal inputs produce equal results
+    virtual std::string getSignature() const;
+    
+    // check if the node is a predicate: an empty result means its condition failed, and
+    // every node reading that result is skipped
+    virtual bool isPredicate() const { return false; }
+    
+    // check if a failed condition rejects the whole frame (predicates with a non-zero
+    // "reject" parameter), so nothing that has not started yet runs
+    bool rejectsFrame() const;
+    
+    // check if running the node does more than compute its result (writing files,
+    // printing a report), so it must run even when its result is already known
+    virtual bool hasSideEffects() const { return false; }
+    
     const NodeId& getId() const { return id_; }
     const std::string& getName() const { return id_; } // name is same as id for now
     const std::string& getType() const { return type_; }
@@ -44,16 +90,12 @@ public:
     const OutputList& getOutputNodeIds() const { return output_node_ids_; }
     const ROI& getROI() const { return roi_; }
     const std::map<std::string, double>& getParameters() const { return parameters_; }
-    bool isExecuted() const { return executed_; }
-    const cv::Mat& getResult() const { return result_; }
     
     void setInputNodeIds(const InputList& inputs) { input_node_ids_ = inputs; }
     void setOutputNodeIds(const OutputList& outputs) { output_node_ids_ = outputs; }
-    void setROI(const ROI& roi) { roi_ = roi; }
-    void setParameters(const std::map<std::string, double>& params) { parameters_ = params; }
-    void setParameter(const std::string& key, double value) { parameters_[key] = value; }
-    void setExecuted(bool executed) { executed_ = executed; }
-    void setResult(const cv::Mat& result) { result_ = result; }
+    void setROI(const ROI& roi) { roi_ = roi; dirty_ = true; }
+    void setParameters(const std::map<std::string, double>& params) { parameters_ = params; dirty_ = true; }
+    void setParameter(const std::string& key, double value) { parameters_[key] = value; dirty_ = true; }
     
     void addInput(const NodeId& input_node_id);
     
@@ -63,6 +105,11 @@ public:
     
     bool removeOutput(const NodeId& output_node_id);
     
+    // add connections without the duplicate check (the caller guarantees uniqueness)
+    void appendInput(const NodeId& input_node_id) { input_node_ids_.push_back(input_node_id); }
+    
+    void appendOutput(const NodeId& output_node_id) { output_node_ids_.push_back(output_node_id); }
+    
     bool hasInput(const NodeId& input_node_id) const;
     
     bool hasOutput(const NodeId& output_node_id) const;
@@ -71,7 +118,22 @@ public:
     
     size_t getOutputCount() const { return output_node_ids_.size(); }
     
-    bool isReadyForExecution() const { return !executed_; }
+    // check if the roi, parameters or image path changed since the executor last compiled
+    // the graph (results of this node and everything downstream are then out of date)
+    bool isDirty() const { return dirty_; }
     
-    void resetExecution();
-}; 
\ No newline at end of file
+    // flag the node as changed, e.g. when the file behind an input node was replaced
+    void markDirty() { dirty_ = true; }
+    
+    // called by the executor once the change is reflected in its plan
+    void clearDirty() { dirty_ = false; }
+    
+    // check if the node may be shed when a frame would miss its deadline (its input is
+    // then passed on unprocessed); required nodes always run
+    bool isOptional() const { return optional_; }
+    
+    void setOptional(bool optional) { optional_ = optional; }
+};
+
+// id of a node standing in for several nodes, e.g. "brightness1+contrast1"
+NodeId joinNodeIds(const std::vector<GraphNode*>& nodes); 
\ No newline at end of file
@@ -24,5 +24,5 @@ public:
     const std::string& getImagePath() const { return image_path_; }
     
     // set image path
-    void setImagePath(const std::string& path) { image_path_ = path; }
+    void setImagePath(const std::string& path) { image_path_ = path; dirty_ = true; }
 }; 
\ No newline at end of file
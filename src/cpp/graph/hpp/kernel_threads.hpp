@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+
+// shares the machine's hardware threads between graph nodes running at the same time and
+// the threads OpenCV's own kernels (cv::parallel_for_) may use. OpenCV's thread count is
+// process-wide, so every running graph holds a lease saying how many of its nodes run at
+// once (its width); while leases of total width w are held, kernels may use cores / w
+// threads: a lone node gets the whole machine, a wide run gets single-threaded kernels.
+// Setting the count resizes OpenCV's worker pool, so it is only set when it differs from
+// OpenCV's current one, and kept between runs until restore()
+class KernelThreadBudget {
+private:
+    mutable std::mutex mutex_;
+    size_t cores_;            // hardware threads shared out
+    size_t active_width_;     // nodes run at the same time by all held leases
+    int applied_threads_;     // kernel threads for the held leases
+    int previous_threads_;    // setting before the first lease, brought back by restore()
+    bool changed_;            // OpenCV's setting is the budget's, not previous_threads_
+
+    KernelThreadBudget();
+
+    // give OpenCV its share of the cores for the current width (mutex_ held)
+    void apply();
+
+public:
+    // process-wide budget
+    static KernelThreadBudget& instance();
+
+    // hardware threads shared out
+    size_t getCores() const { return cores_; }
+
+    // threads OpenCV's kernels may use right now (its own setting while no lease is held)
+    int getKernelThreads() const;
+
+    // change the total width of the held leases from from to to
+    void resize(size_t from, size_t to);
+
+    // give OpenCV back the setting it had before the first lease (if no lease is held)
+    void restore();
+};
+
+// holds a lease on the kernel thread budget for width concurrently running nodes
+// (width 0 leaves OpenCV's setting alone)
+class ScopedKernelThreads {
+private:
+    size_t width_;
+
+public:
+    explicit ScopedKernelThreads(size_t width);
+    ~ScopedKernelThreads();
+
+    ScopedKernelThreads(const ScopedKernelThreads&) = delete;
+    ScopedKernelThreads& operator=(const ScopedKernelThreads&) = delete;
+
+    // change the width of the lease (e.g. when a stream's stages start)
+    void setWidth(size_t width);
+};
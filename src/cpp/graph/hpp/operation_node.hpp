@@ -8,6 +8,10 @@
 class OperationNode : public GraphNode {
 private:
     std::unique_ptr<Operation> operation_;
+    PreparedParametersPtr prepared_;   // the node's own parameters, valid while it is not dirty
+    
+    // prepared form of parameters (the node's own are prepared once, others on every call)
+    PreparedParametersPtr getPrepared(const std::map<std::string, double>& parameters) const;
 
 public:
     // constructor
@@ -16,14 +20,46 @@ public:
     // destructor
     ~OperationNode() override = default;
     
+    // parse and validate the node's parameters for the wrapped operation
+    void prepare() override;
+    
     // execute method - applies the wrapped operation
     cv::Mat execute(const std::vector<cv::Mat>& inputs, 
                    const ROI& roi, 
                    const std::map<std::string, double>& parameters) override;
     
+    // execute method - applies the wrapped operation, reusing the input buffer
+    cv::Mat executeInPlace(cv::Mat& input, 
+                           const ROI& roi, 
+                           const std::map<std::string, double>& parameters) override;
+    
+    // execute method - applies the wrapped operation where the result is read
+    cv::Mat executeRegion(cv::Mat& input, 
+                          const ROI& roi, 
+                          const ROI& region, 
+                          const std::map<std::string, double>& parameters) override;
+    
+    // operations can always write into an exclusively owned input
+    bool supportsInPlace() const override { return true; }
+    
+    // pointwise if the wrapped operation is
+    bool isPointwise() const override { return operation_ && operation_->isPointwise(); }
+    
+    // local if the wrapped operation is
+    bool isLocal() const override { return operation_ && operation_->isLocal(); }
+    
+    // region the wrapped operation reads for its roi and parameters
+    ROI getRequiredRegion(const ROI& output_region) const override;
+    
+    // predicate if the wrapped operation is
+    bool isPredicate() const override { return operation_ && operation_->isPredicate(); }
+    
+    // side effects of the wrapped operation (e.g. printed analysis reports)
+    bool hasSideEffects() const override { return operation_ && operation_->hasSideEffects(); }
+    
     // get the wrapped operation
     const Operation* getOperation() const { return operation_.get(); }
     
     // set the wrapped operation
-    void setOperation(std::unique_ptr<Operation> operation) { operation_ = std::move(operation); }
+    void setOperation(std::unique_ptr<Operation> operation) { operation_ = std::move(operation); prepared_.reset(); }
 }; 
\ No newline at end of file
@@ -20,9 +20,12 @@ public:
                    const ROI& roi, 
                    const std::map<std::string, double>& parameters) override;
     
+    // saving the image must happen on every run
+    bool hasSideEffects() const override { return true; }
+    
     // get image path
     const std::string& getImagePath() const { return image_path_; }
     
     // set image path
-    void setImagePath(const std::string& path) { image_path_ = path; }
+    void setImagePath(const std::string& path) { image_path_ = path; dirty_ = true; }
 }; 
\ No newline at end of file
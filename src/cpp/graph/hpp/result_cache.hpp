@@ -0,0 +1,67 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// content-addressed store of node results kept across executor runs; entries are
+// evicted least recently used first once the byte budget is exceeded
+class ResultCache {
+private:
+    struct Entry {
+        uint64_t key;
+        cv::Mat image;
+        size_t bytes;
+    };
+
+    std::list<Entry> entries_;                                        // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;  // key -> entry
+    size_t budget_bytes_;                                             // 0 disables the cache
+    size_t cached_bytes_;
+    size_t hits_;
+    size_t misses_;
+    mutable std::mutex mutex_;
+
+    // drop least recently used entries until the cache fits its budget
+    void evict();
+
+public:
+    // constructor (0 bytes means disabled)
+    explicit ResultCache(size_t budget_bytes = 0);
+
+    // find a result; the returned image shares the cached buffer and must not be written
+    bool lookup(uint64_t key, cv::Mat& image);
+
+    // store a result (shares the buffer, so the caller must not write to it afterwards)
+    void insert(uint64_t key, const cv::Mat& image);
+
+    // set the byte budget (0 disables the cache and drops every entry)
+    void setBudget(size_t budget_bytes);
+
+    // get the byte budget
+    size_t getBudget() const;
+
+    // bytes held by cached results
+    size_t getCachedBytes() const;
+
+    // number of successful lookups so far
+    size_t getHitCount() const;
+
+    // number of failed lookups so far
+    size_t getMissCount() const;
+
+    // drop every entry
+    void clear();
+
+    // 64-bit hash of a byte range, chained from seed
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+    // 64-bit hash of an image's geometry, type and pixels
+    static uint64_t hashImage(const cv::Mat& image);
+
+    // mix value into a running hash
+    static uint64_t combine(uint64_t seed, uint64_t value);
+};
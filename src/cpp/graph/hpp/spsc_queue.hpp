@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// bounded lock-free queue between exactly one producer thread and one consumer thread
+// (stages of a streaming pipeline hand frame indices to each other through it)
+class SpscQueue {
+private:
+    std::vector<size_t> slots_;
+    alignas(64) std::atomic<size_t> head_;   // items popped so far (consumer side)
+    alignas(64) std::atomic<size_t> tail_;   // items pushed so far (producer side)
+    std::mutex mutex_;                       // only taken to sleep on a full or empty queue
+    std::condition_variable changed_;        // an item was pushed or popped
+    std::atomic<size_t> waiters_;            // threads asleep (or about to sleep) on changed_
+
+    // wake the other side after a push or pop, if it sleeps
+    void notifyWaiters();
+
+public:
+    // constructor (capacity is the number of items the queue holds at most)
+    explicit SpscQueue(size_t capacity);
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // push an item (producer side), returns false if the queue is full
+    bool tryPush(size_t item);
+
+    // pop the oldest item (consumer side), returns false if the queue is empty
+    bool tryPop(size_t& item);
+
+    // push an item, sleeping while the queue is full; returns false if cancelled first
+    bool push(size_t item, const std::atomic<bool>& cancelled);
+
+    // pop the oldest item, sleeping while the queue is empty; returns false if cancelled first
+    bool pop(size_t& item, const std::atomic<bool>& cancelled);
+
+    // wake both sides to look at the queue again (e.g. after cancelling)
+    void wake();
+
+    // maximum number of items
+    size_t getCapacity() const { return slots_.size(); }
+};
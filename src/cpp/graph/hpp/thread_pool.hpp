@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent worker pool used by the graph executor for parallel execution
+class ThreadPool {
+private:
+    // a batch of indexed tasks shared between the caller and the workers
+    struct Job {
+        std::function<void(size_t)> task;
+        size_t count = 0;
+        std::atomic<size_t> next_index{0};
+        std::atomic<size_t> finished{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+        bool pooled = false;    // the caller allocates images through the buffer pool
+    };
+
+    std::vector<std::thread> workers_;      // persistent worker threads
+    std::deque<std::shared_ptr<Job>> jobs_; // jobs with unclaimed tasks
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+
+    // main loop of every worker thread
+    void workerLoop();
+
+    // claim and run tasks of a job until none are left
+    static void runTasks(Job& job);
+
+public:
+    // constructor (0 threads means one worker per extra hardware thread)
+    explicit ThreadPool(size_t num_threads = 0);
+
+    // destructor joins all workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of worker threads (the calling thread also takes part in parallelFor)
+    size_t getThreadCount() const { return workers_.size(); }
+
+    // run task(0) .. task(count - 1) on the workers and the calling thread,
+    // returns once every task has finished and rethrows the first exception
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "graph_node.hpp"
+#include "thread_pool.hpp"
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <vector>
+
+// node replacing a linear chain of local nodes (blur, sharpen, brightness, contrast);
+// the image is split into tiles and the whole chain runs tile by tile, so the data
+// stays in cache between stages. every tile is read with a halo grown backwards from
+// each stage's kernel radius, which keeps the result bit-identical to untiled execution
+class TiledChainNode : public GraphNode {
+private:
+    std::vector<GraphNode*> stages_;                 // stages in execution order
+    std::vector<std::shared_ptr<GraphNode>> fused_;  // fused pointwise runs among the stages
+    int tile_size_;                                  // tile edge length in pixels
+    ThreadPool* thread_pool_;                        // spreads tiles across cores (may be null)
+
+    // compute region of the result (clipped to the image) tile by tile
+    cv::Mat executeTiles(const cv::Mat& input, const ROI& region) const;
+
+    // run the chain on one tile of the result and copy it into output
+    void executeTile(const cv::Mat& input, const ROI& tile, cv::Mat& output) const;
+
+public:
+    // constructor (stages must be local and, unless pointwise, process the full image;
+    // consecutive pointwise stages sharing a roi are fused if fuse_pointwise is set)
+    TiledChainNode(const std::vector<GraphNode*>& stages, int tile_size,
+                   ThreadPool* thread_pool, bool fuse_pointwise);
+
+    // destructor
+    ~TiledChainNode() override = default;
+
+    // check if a node can be a stage of a tiled chain
+    static bool canTile(const GraphNode* node);
+
+    // execute method - runs the chain over the whole image
+    cv::Mat execute(const std::vector<cv::Mat>& inputs, 
+                   const ROI& roi, 
+                   const std::map<std::string, double>& parameters) override;
+
+    // execute method - runs the chain over the tiles covering the region (never
+    // writes to the input)
+    cv::Mat executeRegion(cv::Mat& input, 
+                          const ROI& roi, 
+                          const ROI& region, 
+                          const std::map<std::string, double>& parameters) override;
+
+    // every stage is local, so the chain is too
+    bool isLocal() const override { return true; }
+
+    // region read by the first stage to produce output_region of the last one
+    ROI getRequiredRegion(const ROI& output_region) const override;
+
+    // the signatures of the stages (the tile size does not change the result)
+    std::string getSignature() const override;
+
+    // get the stages
+    const std::vector<GraphNode*>& getStages() const { return stages_; }
+};
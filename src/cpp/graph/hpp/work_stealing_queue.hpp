@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// per-worker task queue: the owner works on the back, idle workers steal from the front
+class WorkStealingQueue {
+private:
+    std::deque<size_t> tasks_;
+    std::mutex mutex_;
+
+public:
+    // push a task (owner side)
+    void push(size_t task);
+
+    // pop the most recently pushed task (owner side), returns false if empty
+    bool pop(size_t& task);
+
+    // take the oldest task (thief side), returns false if empty
+    bool steal(size_t& task);
+};
@@ -1,5 +1,6 @@
 #include "../hpp/base_operation.hpp"
 #include <iostream>
+#include <stdexcept>
 
 // roi utility functions
 namespace ROITools {
@@ -18,37 +19,224 @@ namespace ROITools {
         processed_roi.copyTo(output(cv::Rect(roi.x, roi.y, roi.width, roi.height)));
         return output;
     }
+    
+    cv::Mat writeROI(cv::Mat& image, const cv::Mat& processed_roi, const ROI& roi) {
+        if (roi.full_image) {
+            return processed_roi;
+        }
+        cv::Mat target = image(cv::Rect(roi.x, roi.y, roi.width, roi.height));
+        processed_roi.copyTo(target);
+        return image;
+    }
+    
+    bool isEmpty(const ROI& region) {
+        return !region.full_image && (region.width <= 0 || region.height <= 0);
+    }
+    
+    bool isSame(const ROI& a, const ROI& b) {
+        if (a.full_image || b.full_image) {
+            return a.full_image == b.full_image;
+        }
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+    }
+    
+    ROI unite(const ROI& a, const ROI& b) {
+        if (a.full_image || b.full_image) {
+            return ROI(0, 0, 0, 0, true);
+        }
+        if (isEmpty(a)) {
+            return b;
+        }
+        if (isEmpty(b)) {
+            return a;
+        }
+        cv::Rect rect = cv::Rect(a.x, a.y, a.width, a.height) | cv::Rect(b.x, b.y, b.width, b.height);
+        return ROI(rect.x, rect.y, rect.width, rect.height);
+    }
+    
+    ROI intersect(const ROI& a, const ROI& b) {
+        if (a.full_image) {
+            return b;
+        }
+        if (b.full_image) {
+            return a;
+        }
+        cv::Rect rect = cv::Rect(a.x, a.y, a.width, a.height) & cv::Rect(b.x, b.y, b.width, b.height);
+        return ROI(rect.x, rect.y, rect.width, rect.height);
+    }
+    
+    ROI expand(const ROI& region, int radius) {
+        if (region.full_image || isEmpty(region)) {
+            return region;
+        }
+        return ROI(region.x - radius, region.y - radius, region.width + 2 * radius, region.height + 2 * radius);
+    }
+    
+    ROI clip(const ROI& region, const cv::Size& size) {
+        return intersect(region, ROI(0, 0, size.width, size.height));
+    }
+    
+    ROI translate(const ROI& region, int dx, int dy) {
+        if (region.full_image) {
+            return region;
+        }
+        return ROI(region.x + dx, region.y + dy, region.width, region.height);
+    }
 }
 
 // base class implementation - non-virtual interface pattern
-cv::Mat Operation::execute(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params) {
+PreparedParametersPtr Operation::prepare(const std::map<std::string, double>& params) const {
+    // parameter validation, once for every run that follows
+    bool valid = false;
+    try {
+        valid = validateParametersImpl(params);
+    } catch (const std::invalid_argument& error) {
+        throw std::runtime_error("invalid parameters for operation: " + getNameImpl() + " (" + error.what() + ")");
+    }
+    if (!valid) {
+        throw std::runtime_error("invalid parameters for operation: " + getNameImpl());
+    }
+
+    std::shared_ptr<PreparedParameters> prepared = prepareImpl(params);
+    prepared->parameters = params;
+    return prepared;
+}
+
+std::shared_ptr<PreparedParameters> Operation::prepareImpl(const std::map<std::string, double>& params) const {
+    return std::make_shared<PreparedParameters>();
+}
+
+PreparedParametersPtr Operation::prepareCached(const std::map<std::string, double>& params) {
+    std::lock_guard<std::mutex> lock(prepared_mutex_);
+    if (!last_prepared_ || last_prepared_->parameters != params) {
+        last_prepared_ = prepare(params);
+    }
+    return last_prepared_;
+}
+
+cv::Mat Operation::run(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) {
     // pre-execution validation
-    if (!preExecute(input, roi, params)) {
+    if (!preExecute(input, roi, prepared.parameters)) {
         throw std::runtime_error("pre-execution validation failed for operation: " + getNameImpl());
     }
 
-    // parameter validation
-    if (!validateParameters(params)) {
-        throw std::runtime_error("invalid parameters for operation: " + getNameImpl());
+    cv::Mat result = runImpl(input, roi, prepared);
+
+    // post-execution validation
+    if (!postExecute(input, result, roi, prepared.parameters)) {
+        throw std::runtime_error("post-execution validation failed for operation: " + getNameImpl());
     }
 
-    // execute operation
-    cv::Mat result = executeImpl(input, roi, params);
+    return result;
+}
+
+cv::Mat Operation::runInPlace(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    // pre-execution validation
+    if (!preExecute(image, roi, prepared.parameters)) {
+        throw std::runtime_error("pre-execution validation failed for operation: " + getNameImpl());
+    }
+
+    cv::Mat result = runInPlaceImpl(image, roi, prepared);
+
+    // post-execution validation
+    if (!postExecute(image, result, roi, prepared.parameters)) {
+        throw std::runtime_error("post-execution validation failed for operation: " + getNameImpl());
+    }
+
+    return result;
+}
+
+cv::Mat Operation::runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    return runImpl(image, roi, prepared);
+}
+
+cv::Mat Operation::runRegion(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared) {
+    // pre-execution validation
+    if (!preExecute(image, roi, prepared.parameters)) {
+        throw std::runtime_error("pre-execution validation failed for operation: " + getNameImpl());
+    }
+
+    cv::Mat result = runRegionImpl(image, roi, ROITools::clip(region, image.size()), prepared);
 
     // post-execution validation
-    if (!postExecute(input, result, roi, params)) {
+    if (!postExecute(image, result, roi, prepared.parameters)) {
         throw std::runtime_error("post-execution validation failed for operation: " + getNameImpl());
     }
 
     return result;
 }
 
+cv::Mat Operation::runRegionImpl(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared) {
+    ROI processed = ROITools::intersect(roi, region);
+    if (ROITools::isEmpty(processed)) {
+        return image;
+    }
+    return runInPlaceImpl(image, processed, prepared);
+}
+
+cv::Mat Operation::execute(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params) {
+    // parameter validation (skipped while params match the last call) and execution
+    return run(input, roi, *prepareCached(params));
+}
+
+cv::Mat Operation::executeInPlace(cv::Mat& image, const ROI& roi, const std::map<std::string, double>& params) {
+    return runInPlace(image, roi, *prepareCached(params));
+}
+
+cv::Mat Operation::executeRegion(cv::Mat& image, const ROI& roi, const ROI& region, const std::map<std::string, double>& params) {
+    return runRegion(image, roi, region, *prepareCached(params));
+}
+
 std::string Operation::getName() const {
     return getNameImpl();
 }
 
 bool Operation::validateParameters(const std::map<std::string, double>& parameters) const {
-    return validateParametersImpl(parameters);
+    try {
+        return validateParametersImpl(parameters);
+    } catch (const std::invalid_argument&) {
+        return false;
+    }
+}
+
+bool Operation::isPointwise() const {
+    return isPointwiseImpl();
+}
+
+bool Operation::isPointwiseImpl() const {
+    return false;
+}
+
+bool Operation::isLocal() const {
+    return isLocalImpl();
+}
+
+bool Operation::isLocalImpl() const {
+    return false;
+}
+
+bool Operation::hasSideEffects() const {
+    return hasSideEffectsImpl();
+}
+
+bool Operation::hasSideEffectsImpl() const {
+    return false;
+}
+
+bool Operation::isPredicate() const {
+    return isPredicateImpl();
+}
+
+bool Operation::isPredicateImpl() const {
+    return false;
+}
+
+ROI Operation::getRequiredRegion(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& params) const {
+    return getRequiredRegionImpl(output_region, roi, params);
+}
+
+ROI Operation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& params) const {
+    return ROI(0, 0, 0, 0, true);
 }
 
 bool Operation::preExecute(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params) const {
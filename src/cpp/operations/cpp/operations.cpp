@@ -6,96 +6,414 @@
 #include <cmath> // For std::abs
 #include <numeric> // For std::accumulate
 #include <limits> // For std::numeric_limits
+#include <stdexcept>
+#include <opencv2/core/hal/intrin.hpp> // universal intrinsics
 
-cv::Mat BrightnessOperation::executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params) {
-    // get brightness factor from parameters (default to 1.0 if not specified)
-    double factor = 1.0;
-    auto it = params.find("factor");
-    if (it != params.end()) {
-        factor = it->second;
+namespace {
+    // read a parameter, falling back to its default if not specified
+    double getParameter(const std::map<std::string, double>& params, const std::string& key, double default_value) {
+        auto it = params.find(key);
+        return (it != params.end()) ? it->second : default_value;
     }
     
-    // extract ROI from input image
-    cv::Mat roi_image = ROITools::extractROI(input, roi);
-    cv::Mat output;
+    // read an odd kernel size parameter (even sizes are rounded up)
+    int getKernelSize(const std::map<std::string, double>& params, int default_value) {
+        int kernel_size = static_cast<int>(getParameter(params, "kernel_size", default_value));
+        if (kernel_size % 2 == 0) {
+            kernel_size += 1;
+        }
+        return kernel_size;
+    }
+    
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    // value * factor rounded half to even and saturated, for one vector of 16-bit values
+    cv::v_uint16 scaleLanes(const cv::v_uint16& values, const cv::v_float32& factor) {
+        cv::v_uint32 low, high;
+        cv::v_expand(values, low, high);
+        cv::v_int32 scaled_low = cv::v_round(cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(low)), factor));
+        cv::v_int32 scaled_high = cv::v_round(cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(high)), factor));
+        return cv::v_pack_u(scaled_low, scaled_high);
+    }
+#endif
+    
+    // one row of 8-bit brightness: the single precision product rounded half to even and
+    // saturated, exactly what the conversion through a float image computes
+    void scaleBrightnessRow(const uchar* src, uchar* dst, int count, float factor) {
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+        cv::v_float32 scale = cv::vx_setall_f32(factor);
+        for (; x <= count - lanes; x += lanes) {
+            cv::v_uint16 low, high;
+            cv::v_expand(cv::vx_load(src + x), low, high);
+            cv::v_store(dst + x, cv::v_pack(scaleLanes(low, scale), scaleLanes(high, scale)));
+        }
+#endif
+        for (; x < count; ++x) {
+            dst[x] = cv::saturate_cast<uchar>(src[x] * factor);
+        }
+    }
+    
+    // one row of 16-bit brightness (clamped to 255 like every other depth)
+    void scaleBrightnessRow(const ushort* src, ushort* dst, int count, float factor) {
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = cv::VTraits<cv::v_uint16>::vlanes();
+        cv::v_float32 scale = cv::vx_setall_f32(factor);
+        cv::v_uint16 limit = cv::vx_setall_u16(255);
+        for (; x <= count - lanes; x += lanes) {
+            cv::v_store(dst + x, cv::v_min(scaleLanes(cv::vx_load(src + x), scale), limit));
+        }
+#endif
+        for (; x < count; ++x) {
+            dst[x] = std::min<ushort>(cv::saturate_cast<ushort>(src[x] * factor), 255);
+        }
+    }
+    
+    // scale every row of an 8 or 16-bit image in one pass (dst may be src)
+    template <typename T>
+    void scaleBrightnessRows(const cv::Mat& src, cv::Mat& dst, float factor) {
+        dst.create(src.size(), src.type());
+        cv::Size size(src.cols * src.channels(), src.rows);
+        if (src.isContinuous() && dst.isContinuous()) {
+            size.width *= size.height;
+            size.height = 1;
+        }
+        for (int y = 0; y < size.height; ++y) {
+            scaleBrightnessRow(src.ptr<T>(y), dst.ptr<T>(y), size.width, factor);
+        }
+    }
+    
+    // scale pixel values by factor and clamp them to the valid range (dst may be src)
+    void scaleBrightness(const cv::Mat& src, cv::Mat& dst, double factor) {
+        // 8 and 16-bit images in a single vectorized pass, bit-exact with the float path
+        if (src.depth() == CV_8U) {
+            scaleBrightnessRows<uchar>(src, dst, static_cast<float>(factor));
+            return;
+        }
+        if (src.depth() == CV_16U) {
+            scaleBrightnessRows<ushort>(src, dst, static_cast<float>(factor));
+            return;
+        }
+        
+        // convert to float for processing
+        cv::Mat float_img;
+        src.convertTo(float_img, CV_32F);
+        
+        // apply brightness adjustment
+        float_img *= factor;
+        
+        // convert back to original type
+        float_img.convertTo(dst, src.type());
+        
+        // ensure values are clamped to valid range
+        cv::threshold(dst, dst, 255, 255, cv::THRESH_TRUNC);
+        cv::threshold(dst, dst, 0, 0, cv::THRESH_TOZERO);
+    }
     
-    // convert to float for processing
-    cv::Mat float_img;
-    roi_image.convertTo(float_img, CV_32F);
+    // input region read by a filter of the given radius that runs on roi: the pixels it
+    // rewrites plus their neighbourhood, and everything else is passed through
+    ROI filterRegion(const ROI& output_region, const ROI& roi, int radius) {
+        if (output_region.full_image) {
+            return output_region;
+        }
+        ROI processed = ROITools::intersect(output_region, roi);
+        return ROITools::unite(output_region, ROITools::expand(processed, radius));
+    }
+    
+    // gaussian blur with coefficients built once (kernel, from gaussianKernel): whole
+    // images always go to GaussianBlur, so its HAL, IPP and OpenCL dispatch and its
+    // fixed-point path for 8 and 16-bit stay as they were. only submatrices (rois, tiles,
+    // bands) run the separable filter with the cached kernel directly; that matches the
+    // generic GaussianBlur path but is not guaranteed bit-exact with GaussianBlur on builds
+    // whose HAL, IPP or OpenCL backends handle submatrices themselves
+    void gaussianBlur(const cv::Mat& src, cv::Mat& dst, int kernel_size, double sigma, const cv::Mat& kernel) {
+        if (!src.isSubmatrix() || src.depth() == CV_64F || kernel.empty()) {
+            cv::GaussianBlur(src, dst, cv::Size(kernel_size, kernel_size), sigma);
+            return;
+        }
+        cv::sepFilter2D(src, dst, src.depth(), kernel, kernel);
+    }
     
-    // apply brightness adjustment
-    float_img *= factor;
+    // coefficients GaussianBlur uses for a square kernel on its float path
+    cv::Mat gaussianKernel(int kernel_size, double sigma) {
+        return cv::getGaussianKernel(kernel_size, std::max(sigma, 0.0), CV_32F);
+    }
+    
+    // gaussian blur of a region of src, bit-exact with blurring the whole image: the
+    // region is padded with its real neighbours (mirrored past the image border) into a
+    // standalone image, so GaussianBlur takes the same fixed-point path as on the whole
+    // image instead of the floating-point path it uses for submatrices
+    cv::Mat blurRegion(const cv::Mat& src, const ROI& region, int kernel_size, double sigma) {
+        int radius = kernel_size / 2;
+        cv::Mat padded, blurred;
+        cv::copyMakeBorder(ROITools::extractROI(src, region), padded, radius, radius, radius, radius, cv::BORDER_REFLECT_101);
+        cv::GaussianBlur(padded, blurred, cv::Size(kernel_size, kernel_size), sigma);
+        return blurred(cv::Rect(radius, radius, region.width, region.height));
+    }
+    
+    // rows of the blurred image the fused unsharp mask keeps at once: about 512 KB so the
+    // band is still in cache when it is combined with the source, at least 32 halo radii so
+    // reblurring the halo rows costs little, and a multiple of 64 elements long so that
+    // addWeighted splits a continuous image into the same vector blocks band by band
+    int unsharpBandRows(const cv::Mat& src, int radius) {
+        const size_t band_bytes = 512 * 1024;
+        int alignment = 64 / std::gcd(src.cols * src.channels(), 64);
+        int rows = static_cast<int>(band_bytes / std::max<size_t>(1, src.cols * src.elemSize()));
+        rows = std::max(rows, 32 * radius);
+        return std::max(alignment, rows / alignment * alignment);
+    }
+    
+    // unsharp mask: (1 + strength) * src - strength * blur(src), fused band by band so
+    // only a band of the blurred image exists at a time instead of a whole blurred copy
+    // that is written out and read back; dst must not share memory with src. bands of a
+    // whole image go to GaussianBlur with their real neighbour rows as a halo, mirrored
+    // only at the image border (BORDER_ISOLATED), so they are blurred as the whole image
+    // would be; bands of a submatrix read their neighbours from src through gaussianBlur
+    // (the cached kernel, see there for its exactness)
+    void unsharpMask(const cv::Mat& src, cv::Mat& dst, double strength, int kernel_size, const cv::Mat& kernel) {
+        int radius = kernel_size / 2;
+        int band_rows = unsharpBandRows(src, radius);
+        if (src.rows <= band_rows) {
+            cv::Mat blurred;
+            gaussianBlur(src, blurred, kernel_size, 0, kernel);
+            cv::addWeighted(src, 1.0 + strength, blurred, -strength, 0, dst);
+            return;
+        }
+        
+        bool whole_image = !src.isSubmatrix();
+        dst.create(src.size(), src.type());
+        cv::Mat blurred;
+        for (int y = 0; y < src.rows; y += band_rows) {
+            int rows = std::min(band_rows, src.rows - y);
+            cv::Mat band = src.rowRange(y, y + rows);
+            cv::Mat band_blurred;
+            if (whole_image) {
+                int top = std::max(0, y - radius);
+                int bottom = std::min(src.rows, y + rows + radius);
+                cv::GaussianBlur(src.rowRange(top, bottom), blurred, cv::Size(kernel_size, kernel_size), 0, 0,
+                                 cv::BORDER_DEFAULT | cv::BORDER_ISOLATED);
+                band_blurred = blurred.rowRange(y - top, y - top + rows);
+            } else {
+                gaussianBlur(band, blurred, kernel_size, 0, kernel);
+                band_blurred = blurred;
+            }
+            
+            cv::Mat band_dst = dst.rowRange(y, y + rows);
+            cv::addWeighted(band, 1.0 + strength, band_blurred, -strength, 0, band_dst);
+        }
+    }
+    
+    // grayscale version of the roi of an image, the metrics below work on intensity
+    cv::Mat grayROI(const cv::Mat& image, const ROI& roi) {
+        cv::Mat roi_image = ROITools::extractROI(image, roi);
+        cv::Mat gray;
+        if (roi_image.channels() == 3) {
+            cv::cvtColor(roi_image, gray, cv::COLOR_BGR2GRAY);
+        } else {
+            gray = roi_image.clone();
+        }
+        return gray;
+    }
+    
+    // variance of the laplacian (high for sharp images, low for blurry ones)
+    double laplacianVariance(const cv::Mat& gray) {
+        cv::Mat laplacian;
+        cv::Laplacian(gray, laplacian, CV_64F);
+        
+        cv::Scalar mean, stddev;
+        cv::meanStdDev(laplacian, mean, stddev);
+        return stddev[0] * stddev[0];
+    }
+    
+    // number of pixels on a canny edge
+    int countEdgePixels(const cv::Mat& gray) {
+        cv::Mat edges;
+        cv::Canny(gray, edges, 50, 150);
+        return cv::countNonZero(edges);
+    }
+    
+    // sum of the gradient magnitudes sqrt(dx^2 + dy^2) of one row of 16-bit gradients,
+    // accumulated in single precision (a 3x3 sobel of 8-bit pixels squares exactly in it)
+    float gradientMagnitudeRow(const short* dx, const short* dy, int count) {
+        int x = 0;
+        float sum = 0.0f;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = cv::VTraits<cv::v_int16>::vlanes();
+        cv::v_float32 acc = cv::vx_setzero_f32();
+        for (; x <= count - lanes; x += lanes) {
+            cv::v_int32 dx_low, dx_high, dy_low, dy_high;
+            cv::v_expand(cv::vx_load(dx + x), dx_low, dx_high);
+            cv::v_expand(cv::vx_load(dy + x), dy_low, dy_high);
+            cv::v_float32 fx = cv::v_cvt_f32(dx_low), fy = cv::v_cvt_f32(dy_low);
+            acc = cv::v_add(acc, cv::v_sqrt(cv::v_muladd(fx, fx, cv::v_mul(fy, fy))));
+            fx = cv::v_cvt_f32(dx_high);
+            fy = cv::v_cvt_f32(dy_high);
+            acc = cv::v_add(acc, cv::v_sqrt(cv::v_muladd(fx, fx, cv::v_mul(fy, fy))));
+        }
+        sum = cv::v_reduce_sum(acc);
+#endif
+        for (; x < count; ++x) {
+            sum += std::sqrt(static_cast<float>(dx[x] * dx[x] + dy[x] * dy[x]));
+        }
+        return sum;
+    }
+    
+    // sum of the gradient magnitudes of a strip of gray (a submatrix of it) from 16-bit
+    // sobel gradients that read its neighbours from gray and mirror past the image
+    // border (BORDER_DEFAULT, like the double precision sobel of the metric)
+    double stripMagnitude(const cv::Mat& strip) {
+        if (strip.empty()) {
+            return 0.0;
+        }
+        cv::Mat dx, dy;
+        cv::Sobel(strip, dx, CV_16S, 1, 0, 3);
+        cv::Sobel(strip, dy, CV_16S, 0, 1, 3);
+        return gradientMagnitudeRow(dx.ptr<short>(), dy.ptr<short>(), static_cast<int>(dx.total()));
+    }
+    
+    // read the optional min and max parameters of a predicate
+    std::shared_ptr<PreparedParameters> prepareRange(const std::map<std::string, double>& params) {
+        auto prepared = std::make_shared<RangeParameters>();
+        prepared->min = getParameter(params, "min", prepared->min);
+        prepared->max = getParameter(params, "max", prepared->max);
+        return prepared;
+    }
+    
+    // check a metric against the min and max of a predicate
+    bool isInRange(double value, const RangeParameters& range) {
+        return value >= range.min && value <= range.max;
+    }
     
-    // convert back to original type
-    float_img.convertTo(output, roi_image.type());
+    // min must not exceed max (both are optional; throws std::invalid_argument otherwise)
+    bool validateRange(const std::map<std::string, double>& params, const std::string& name) {
+        if (params.count("min") && params.count("max") && params.at("min") > params.at("max")) {
+            throw std::invalid_argument(name + " min must not exceed max");
+        }
+        return true;
+    }
+}
+
+std::shared_ptr<PreparedParameters> BrightnessOperation::prepareImpl(const std::map<std::string, double>& params) const {
+    // get brightness factor from parameters (default to 1.0 if not specified)
+    auto prepared = std::make_shared<Parameters>();
+    prepared->factor = getParameter(params, "factor", prepared->factor);
+    return prepared;
+}
+
+cv::Mat BrightnessOperation::runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
     
-    // ensure values are clamped to valid range
-    cv::threshold(output, output, 255, 255, cv::THRESH_TRUNC);
-    cv::threshold(output, output, 0, 0, cv::THRESH_TOZERO);
+    // extract ROI from input image
+    cv::Mat roi_image = ROITools::extractROI(input, roi);
+    cv::Mat output;
+    scaleBrightness(roi_image, output, params.factor);
     
     // apply the processed ROI back to the original image
     return ROITools::applyROI(input, output, roi);
 }
 
+cv::Mat BrightnessOperation::runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
+    
+    // pointwise, so the roi is rewritten in place and nothing else is touched
+    cv::Mat roi_image = ROITools::extractROI(image, roi);
+    scaleBrightness(roi_image, roi_image, params.factor);
+    return image;
+}
+
 std::string BrightnessOperation::getNameImpl() const {
     return "brightness";
 }
 
+bool BrightnessOperation::isLocalImpl() const {
+    return true;
+}
+
+ROI BrightnessOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    return filterRegion(output_region, roi, 0);
+}
+
+bool BrightnessOperation::isPointwiseImpl() const {
+    return true;
+}
+
 bool BrightnessOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
     // check brightness factor
     if (parameters.count("factor")) {
         double factor = parameters.at("factor");
         if (factor < 0.0 || factor > 5.0) {
-            std::cerr << "error: brightness factor must be between 0.0 and 5.0" << std::endl;
-            return false;
+            throw std::invalid_argument("brightness factor must be between 0.0 and 5.0");
         }
     }
     
     return true;
 }
 
-cv::Mat BlurOperation::executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params) {
-    // get parameters with defaults
-    int kernel_size = 5;
-    double sigma = 1.0;
-    
-    auto kernel_it = params.find("kernel_size");
-    if (kernel_it != params.end()) {
-        kernel_size = static_cast<int>(kernel_it->second);
-    }
-    
-    auto sigma_it = params.find("sigma");
-    if (sigma_it != params.end()) {
-        sigma = sigma_it->second;
-    }
-    
-    // ensure kernel size is odd
-    if (kernel_size % 2 == 0) {
-        kernel_size += 1;
-    }
+std::shared_ptr<PreparedParameters> BlurOperation::prepareImpl(const std::map<std::string, double>& params) const {
+    // get parameters with defaults (kernel size is forced odd)
+    auto prepared = std::make_shared<Parameters>();
+    prepared->kernel_size = getKernelSize(params, prepared->kernel_size);
+    prepared->sigma = getParameter(params, "sigma", prepared->sigma);
+    prepared->kernel = gaussianKernel(prepared->kernel_size, prepared->sigma);
+    return prepared;
+}
+
+cv::Mat BlurOperation::runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
     
     // extract ROI from input image
     cv::Mat roi_image = ROITools::extractROI(input, roi);
     cv::Mat output;
     
     // apply Gaussian blur
-    cv::GaussianBlur(roi_image, output, cv::Size(kernel_size, kernel_size), sigma);
+    gaussianBlur(roi_image, output, params.kernel_size, params.sigma, params.kernel);
     
     // apply the processed ROI back to the original image
     return ROITools::applyROI(input, output, roi);
 }
 
+cv::Mat BlurOperation::runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
+    
+    // the filter reads neighbours, so blur into a patch and copy only the roi back
+    cv::Mat roi_image = ROITools::extractROI(image, roi);
+    cv::Mat output;
+    gaussianBlur(roi_image, output, params.kernel_size, params.sigma, params.kernel);
+    return ROITools::writeROI(image, output, roi);
+}
+
+cv::Mat BlurOperation::runRegionImpl(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared) {
+    // a partial roi is blurred on the floating-point path, whose rounding depends on the
+    // extent of the roi, so it is always blurred whole
+    if (!roi.full_image) {
+        return runInPlaceImpl(image, roi, prepared);
+    }
+    
+    const auto& params = static_cast<const Parameters&>(prepared);
+    blurRegion(image, region, params.kernel_size, params.sigma).copyTo(ROITools::extractROI(image, region));
+    return image;
+}
+
 std::string BlurOperation::getNameImpl() const {
     return "blur";
 }
 
+bool BlurOperation::isLocalImpl() const {
+    return true;
+}
+
+ROI BlurOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    // the kernel reaches kernel_size / 2 pixels past every blurred pixel
+    return filterRegion(output_region, roi, getKernelSize(parameters, 5) / 2);
+}
+
 bool BlurOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
     // check kernel size
     if (parameters.count("kernel_size")) {
         double kernel_size = parameters.at("kernel_size");
         if (kernel_size < 3 || kernel_size > 31) {
-            std::cerr << "error: blur kernel size must be between 3 and 31" << std::endl;
-            return false;
+            throw std::invalid_argument("blur kernel size must be between 3 and 31");
         }
     }
     
@@ -103,51 +421,66 @@ bool BlurOperation::validateParametersImpl(const std::map<std::string, double>&
     if (parameters.count("sigma")) {
         double sigma = parameters.at("sigma");
         if (sigma < 0.1 || sigma > 10.0) {
-            std::cerr << "error: blur sigma must be between 0.1 and 10.0" << std::endl;
-            return false;
+            throw std::invalid_argument("blur sigma must be between 0.1 and 10.0");
         }
     }
     
     return true;
 }
 
-cv::Mat ContrastOperation::executeImpl(const cv::Mat& image, const ROI& roi, const std::map<std::string, double>& parameters) {
+std::shared_ptr<PreparedParameters> ContrastOperation::prepareImpl(const std::map<std::string, double>& parameters) const {
     // get parameters with defaults
-    double factor = 1.0;
-    double brightness_offset = 0.0;
-    
-    auto factor_it = parameters.find("factor");
-    if (factor_it != parameters.end()) {
-        factor = factor_it->second;
-    }
-    
-    auto offset_it = parameters.find("brightness_offset");
-    if (offset_it != parameters.end()) {
-        brightness_offset = offset_it->second;
-    }
+    auto prepared = std::make_shared<Parameters>();
+    prepared->factor = getParameter(parameters, "factor", prepared->factor);
+    prepared->brightness_offset = getParameter(parameters, "brightness_offset", prepared->brightness_offset);
+    return prepared;
+}
+
+cv::Mat ContrastOperation::runImpl(const cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
     
     // extract ROI from input image
     cv::Mat roi_image = ROITools::extractROI(image, roi);
     cv::Mat output;
     
     // apply contrast and brightness adjustment
-    roi_image.convertTo(output, -1, factor, brightness_offset);
+    roi_image.convertTo(output, -1, params.factor, params.brightness_offset);
     
     // apply the processed ROI back to the original image
     return ROITools::applyROI(image, output, roi);
 }
 
+cv::Mat ContrastOperation::runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
+    
+    // pointwise, so the roi is rewritten in place and nothing else is touched
+    cv::Mat roi_image = ROITools::extractROI(image, roi);
+    roi_image.convertTo(roi_image, -1, params.factor, params.brightness_offset);
+    return image;
+}
+
 std::string ContrastOperation::getNameImpl() const {
     return "contrast";
 }
 
+bool ContrastOperation::isLocalImpl() const {
+    return true;
+}
+
+ROI ContrastOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    return filterRegion(output_region, roi, 0);
+}
+
+bool ContrastOperation::isPointwiseImpl() const {
+    return true;
+}
+
 bool ContrastOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
     // check contrast factor
     if (parameters.count("factor")) {
         double factor = parameters.at("factor");
         if (factor < 0.0 || factor > 3.0) {
-            std::cerr << "error: contrast factor must be between 0.0 and 3.0" << std::endl;
-            return false;
+            throw std::invalid_argument("contrast factor must be between 0.0 and 3.0");
         }
     }
     
@@ -155,44 +488,41 @@ bool ContrastOperation::validateParametersImpl(const std::map<std::string, doubl
     if (parameters.count("brightness_offset")) {
         double offset = parameters.at("brightness_offset");
         if (offset < -100.0 || offset > 100.0) {
-            std::cerr << "error: brightness offset must be between -100 and 100" << std::endl;
-            return false;
+            throw std::invalid_argument("brightness offset must be between -100 and 100");
         }
     }
     
     return true;
 }
 
-cv::Mat CropOperation::executeImpl(const cv::Mat& image, const ROI& roi, const std::map<std::string, double>& parameters) {
+std::shared_ptr<PreparedParameters> CropOperation::prepareImpl(const std::map<std::string, double>& parameters) const {
     // get crop parameters with defaults
-    int x = 0;
-    int y = 0;
-    int width = image.cols;
-    int height = image.rows;
-    
-    auto x_it = parameters.find("x");
-    if (x_it != parameters.end()) {
-        x = static_cast<int>(x_it->second);
-    }
-    
-    auto y_it = parameters.find("y");
-    if (y_it != parameters.end()) {
-        y = static_cast<int>(y_it->second);
-    }
+    auto prepared = std::make_shared<Parameters>();
+    prepared->x = static_cast<int>(getParameter(parameters, "x", 0));
+    prepared->y = static_cast<int>(getParameter(parameters, "y", 0));
     
     auto width_it = parameters.find("width");
     if (width_it != parameters.end()) {
-        width = static_cast<int>(width_it->second);
-    } else {
-        width = image.cols - x;
+        prepared->width = static_cast<int>(width_it->second);
+        prepared->has_width = true;
     }
     
     auto height_it = parameters.find("height");
     if (height_it != parameters.end()) {
-        height = static_cast<int>(height_it->second);
-    } else {
-        height = image.rows - y;
+        prepared->height = static_cast<int>(height_it->second);
+        prepared->has_height = true;
     }
+    return prepared;
+}
+
+cv::Mat CropOperation::runImpl(const cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
+    
+    // without an explicit size the crop reaches the image border
+    int x = params.x;
+    int y = params.y;
+    int width = params.has_width ? params.width : image.cols - x;
+    int height = params.has_height ? params.height : image.rows - y;
     
     // validate crop region
     if (x < 0 || y < 0 || x >= image.cols || y >= image.rows) {
@@ -218,77 +548,110 @@ std::string CropOperation::getNameImpl() const {
     return "crop";
 }
 
+ROI CropOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    // without an explicit size the crop depends on the image size, so keep it all
+    if (!parameters.count("width") || !parameters.count("height")) {
+        return ROI(0, 0, 0, 0, true);
+    }
+    
+    ROI crop(static_cast<int>(getParameter(parameters, "x", 0)),
+             static_cast<int>(getParameter(parameters, "y", 0)),
+             static_cast<int>(parameters.at("width")),
+             static_cast<int>(parameters.at("height")));
+    if (output_region.full_image) {
+        return crop;
+    }
+    
+    // output coordinates are relative to the crop origin
+    ROI shifted(output_region.x + crop.x, output_region.y + crop.y, output_region.width, output_region.height);
+    return ROITools::intersect(shifted, crop);
+}
+
 bool CropOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
     // check for required parameters
     if (parameters.count("x") && parameters.at("x") < 0) {
-        std::cerr << "error: crop x coordinate must be non-negative" << std::endl;
-        return false;
+        throw std::invalid_argument("crop x coordinate must be non-negative");
     }
     
     if (parameters.count("y") && parameters.at("y") < 0) {
-        std::cerr << "error: crop y coordinate must be non-negative" << std::endl;
-        return false;
+        throw std::invalid_argument("crop y coordinate must be non-negative");
     }
     
     if (parameters.count("width") && parameters.at("width") <= 0) {
-        std::cerr << "error: crop width must be positive" << std::endl;
-        return false;
+        throw std::invalid_argument("crop width must be positive");
     }
     
     if (parameters.count("height") && parameters.at("height") <= 0) {
-        std::cerr << "error: crop height must be positive" << std::endl;
-        return false;
+        throw std::invalid_argument("crop height must be positive");
     }
     
     return true;
 }
 
-cv::Mat SharpenOperation::executeImpl(const cv::Mat& image, const ROI& roi, const std::map<std::string, double>& parameters) {
-    // get parameters with defaults
-    double strength = 1.0;
-    int kernel_size = 5;
-    
-    auto strength_it = parameters.find("strength");
-    if (strength_it != parameters.end()) {
-        strength = strength_it->second;
-    }
-    
-    auto kernel_it = parameters.find("kernel_size");
-    if (kernel_it != parameters.end()) {
-        kernel_size = static_cast<int>(kernel_it->second);
-    }
-    
-    // ensure kernel size is odd
-    if (kernel_size % 2 == 0) {
-        kernel_size++;
-    }
+std::shared_ptr<PreparedParameters> SharpenOperation::prepareImpl(const std::map<std::string, double>& parameters) const {
+    // get parameters with defaults (kernel size is forced odd)
+    auto prepared = std::make_shared<Parameters>();
+    prepared->strength = getParameter(parameters, "strength", prepared->strength);
+    prepared->kernel_size = getKernelSize(parameters, prepared->kernel_size);
+    prepared->kernel = gaussianKernel(prepared->kernel_size, 0);
+    return prepared;
+}
+
+cv::Mat SharpenOperation::runImpl(const cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
     
     // extract roi from input image
     cv::Mat roi_image = ROITools::extractROI(image, roi);
     cv::Mat output;
-    
-    // create unsharp mask
-    cv::Mat blurred;
-    cv::GaussianBlur(roi_image, blurred, cv::Size(kernel_size, kernel_size), 0);
-    
-    // apply unsharp mask
-    cv::addWeighted(roi_image, 1.0 + strength, blurred, -strength, 0, output);
+    unsharpMask(roi_image, output, params.strength, params.kernel_size, params.kernel);
     
     // apply the processed roi back to the original image
     return ROITools::applyROI(image, output, roi);
 }
 
+cv::Mat SharpenOperation::runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) {
+    const auto& params = static_cast<const Parameters&>(prepared);
+    
+    // the blur reads neighbours, so sharpen into a patch and copy only the roi back
+    cv::Mat roi_image = ROITools::extractROI(image, roi);
+    cv::Mat output;
+    unsharpMask(roi_image, output, params.strength, params.kernel_size, params.kernel);
+    return ROITools::writeROI(image, output, roi);
+}
+
+cv::Mat SharpenOperation::runRegionImpl(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared) {
+    // a partial roi is blurred on the floating-point path, whose rounding depends on the
+    // extent of the roi, so it is always sharpened whole
+    if (!roi.full_image) {
+        return runInPlaceImpl(image, roi, prepared);
+    }
+    
+    const auto& params = static_cast<const Parameters&>(prepared);
+    cv::Mat blurred = blurRegion(image, region, params.kernel_size, 0);
+    cv::Mat target = ROITools::extractROI(image, region);
+    cv::addWeighted(target, 1.0 + params.strength, blurred, -params.strength, 0, target);
+    return image;
+}
+
 std::string SharpenOperation::getNameImpl() const {
     return "sharpen";
 }
 
+bool SharpenOperation::isLocalImpl() const {
+    return true;
+}
+
+ROI SharpenOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    // the unsharp mask blur reaches kernel_size / 2 pixels past every sharpened pixel
+    return filterRegion(output_region, roi, getKernelSize(parameters, 5) / 2);
+}
+
 bool SharpenOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
     // check strength parameter
     if (parameters.count("strength")) {
         double strength = parameters.at("strength");
         if (strength < 0.0 || strength > 2.0) {
-            std::cerr << "error: sharpen strength must be between 0.0 and 2.0" << std::endl;
-            return false;
+            throw std::invalid_argument("sharpen strength must be between 0.0 and 2.0");
         }
     }
     
@@ -296,42 +659,78 @@ bool SharpenOperation::validateParametersImpl(const std::map<std::string, double
     if (parameters.count("kernel_size")) {
         double kernel_size = parameters.at("kernel_size");
         if (kernel_size < 3 || kernel_size > 15) {
-            std::cerr << "error: sharpen kernel size must be between 3 and 15" << std::endl;
-            return false;
+            throw std::invalid_argument("sharpen kernel size must be between 3 and 15");
         }
     }
     
     return true;
 } 
 
-cv::Mat EdgeCountOperation::executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) {
-    // extract ROI from input image
-    cv::Mat roi_image = ROITools::extractROI(input, roi);
+// edge statistics from one set of 16-bit gradients: the same 3x3 sobel (replicated
+// border) Canny computes internally is run once and handed to Canny, and the edge count
+// and magnitude sum are then taken row by row in a single traversal (rows accumulate in
+// single precision, the total in double). the border mode only matters for the outer
+// ring of pixels, whose magnitudes are recomputed mirrored (BORDER_DEFAULT) so the mean
+// matches the double precision sobel of the baseline metric
+EdgeCountOperation::Statistics EdgeCountOperation::measure(const cv::Mat& gray) {
+    Statistics stats;
+    if (gray.empty()) {
+        return stats;
+    }
     
-    // convert to grayscale for edge detection
-    cv::Mat gray;
-    if (roi_image.channels() == 3) {
-        cv::cvtColor(roi_image, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = roi_image.clone();
+    // other layouts keep the separate canny and double precision sobel
+    if (gray.type() != CV_8UC1) {
+        cv::Mat grad_x, grad_y, grad_magnitude;
+        cv::Sobel(gray, grad_x, CV_64F, 1, 0, 3);
+        cv::Sobel(gray, grad_y, CV_64F, 0, 1, 3);
+        cv::magnitude(grad_x, grad_y, grad_magnitude);
+        stats.edge_pixels = countEdgePixels(gray);
+        stats.mean_magnitude = cv::mean(grad_magnitude)[0];
+        return stats;
     }
     
-    // detect edges using Canny
-    cv::Mat edges;
-    cv::Canny(gray, edges, 50, 150);
+    cv::Mat dx, dy, edges;
+    cv::Sobel(gray, dx, CV_16S, 1, 0, 3, 1, 0, cv::BORDER_REPLICATE);
+    cv::Sobel(gray, dy, CV_16S, 0, 1, 3, 1, 0, cv::BORDER_REPLICATE);
+    cv::Canny(dx, dy, edges, 50, 150);
+    
+    // interior magnitudes from the shared gradients
+    double magnitude_sum = 0.0;
+    for (int y = 0; y < gray.rows; ++y) {
+        const uchar* edge_row = edges.ptr<uchar>(y);
+        for (int x = 0; x < gray.cols; ++x) {
+            stats.edge_pixels += edge_row[x] != 0;
+        }
+        if (y > 0 && y < gray.rows - 1 && gray.cols > 2) {
+            magnitude_sum += gradientMagnitudeRow(dx.ptr<short>(y) + 1, dy.ptr<short>(y) + 1, gray.cols - 2);
+        }
+    }
     
-    // count edge pixels
-    int edge_pixels = cv::countNonZero(edges);
-    int total_pixels = edges.rows * edges.cols;
+    // the outer ring: first and last row, first and last column between them
+    magnitude_sum += stripMagnitude(gray.rowRange(0, 1));
+    if (gray.rows > 1) {
+        magnitude_sum += stripMagnitude(gray.rowRange(gray.rows - 1, gray.rows));
+    }
+    if (gray.rows > 2) {
+        magnitude_sum += stripMagnitude(gray(cv::Rect(0, 1, 1, gray.rows - 2)));
+        if (gray.cols > 1) {
+            magnitude_sum += stripMagnitude(gray(cv::Rect(gray.cols - 1, 1, 1, gray.rows - 2)));
+        }
+    }
+    stats.mean_magnitude = magnitude_sum / gray.total();
+    return stats;
+}
+
+cv::Mat EdgeCountOperation::runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) {
+    // convert the roi to grayscale for edge detection
+    cv::Mat gray = grayROI(input, roi);
+    
+    // count edge pixels and their strength from one set of gradients
+    Statistics stats = measure(gray);
+    int edge_pixels = stats.edge_pixels;
+    int total_pixels = gray.rows * gray.cols;
     double edge_density = static_cast<double>(edge_pixels) / total_pixels;
-    
-    // calculate edge strength using Sobel
-    cv::Mat grad_x, grad_y, grad_magnitude;
-    cv::Sobel(gray, grad_x, CV_64F, 1, 0, 3);
-    cv::Sobel(gray, grad_y, CV_64F, 0, 1, 3);
-    cv::magnitude(grad_x, grad_y, grad_magnitude);
-    
-    double avg_edge_strength = cv::mean(grad_magnitude)[0];
+    double avg_edge_strength = stats.mean_magnitude;
     
     // print analysis results
     std::cout << "=== EDGE COUNT ANALYSIS ===" << std::endl;
@@ -341,39 +740,32 @@ cv::Mat EdgeCountOperation::executeImpl(const cv::Mat& input, const ROI& roi, co
     std::cout << "Average edge strength: " << std::fixed << std::setprecision(2) << avg_edge_strength << std::endl;
     std::cout << "==========================" << std::endl;
     
-    // return the original image unchanged
-    return input.clone();
+    // return the original image unchanged (shared, the analysis never writes to it)
+    return input;
 }
 
 std::string EdgeCountOperation::getNameImpl() const {
     return "edge_count";
 }
 
+ROI EdgeCountOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    // the analysed roi plus whatever downstream reads from the passed-through image
+    return ROITools::unite(output_region, roi);
+}
+
+bool EdgeCountOperation::hasSideEffectsImpl() const {
+    // prints its analysis report
+    return true;
+}
+
 bool EdgeCountOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
     // no parameters to validate for edge count operation
     return true;
 }
 
-cv::Mat BlurDetectionOperation::executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) {
-    // extract ROI from input image
-    cv::Mat roi_image = ROITools::extractROI(input, roi);
-
-    // convert to grayscale if needed
-    cv::Mat gray;
-    if (roi_image.channels() == 3) {
-        cv::cvtColor(roi_image, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = roi_image.clone();
-    }
-
-    // compute Laplacian
-    cv::Mat laplacian;
-    cv::Laplacian(gray, laplacian, CV_64F);
-
-    // calculate variance of Laplacian
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(laplacian, mean, stddev);
-    double variance = stddev[0] * stddev[0];
+cv::Mat BlurDetectionOperation::runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) {
+    // variance of the laplacian of the grayscale roi
+    double variance = laplacianVariance(grayROI(input, roi));
 
     // qualitative label
     std::string blur_label;
@@ -391,17 +783,96 @@ cv::Mat BlurDetectionOperation::executeImpl(const cv::Mat& input, const ROI& roi
     std::cout << "Assessment: " << blur_label << std::endl;
     std::cout << "===============================" << std::endl;
 
-    // return the original image unchanged
-    return input.clone();
+    // return the original image unchanged (shared, the analysis never writes to it)
+    return input;
 }
 
 std::string BlurDetectionOperation::getNameImpl() const {
     return "blur_detection";
 }
 
+ROI BlurDetectionOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    // the analysed roi plus whatever downstream reads from the passed-through image
+    return ROITools::unite(output_region, roi);
+}
+
+bool BlurDetectionOperation::hasSideEffectsImpl() const {
+    // prints its analysis report
+    return true;
+}
+
 bool BlurDetectionOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
     // no parameters to validate for blur detection operation
     return true;
 }
 
- 
\ No newline at end of file
+std::shared_ptr<PreparedParameters> BlurCheckOperation::prepareImpl(const std::map<std::string, double>& parameters) const {
+    return prepareRange(parameters);
+}
+
+cv::Mat BlurCheckOperation::runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) {
+    // same sharpness metric as blur detection
+    double variance = laplacianVariance(grayROI(input, roi));
+    
+    // failed: an empty result switches off everything downstream
+    if (!isInRange(variance, static_cast<const Parameters&>(prepared))) {
+        return cv::Mat();
+    }
+    return input;
+}
+
+std::string BlurCheckOperation::getNameImpl() const {
+    return "blur_check";
+}
+
+ROI BlurCheckOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    // the checked roi plus whatever downstream reads from the passed-through image
+    return ROITools::unite(output_region, roi);
+}
+
+bool BlurCheckOperation::isPredicateImpl() const {
+    return true;
+}
+
+bool BlurCheckOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
+    return validateRange(parameters, "blur check");
+}
+
+std::shared_ptr<PreparedParameters> EdgeCheckOperation::prepareImpl(const std::map<std::string, double>& parameters) const {
+    return prepareRange(parameters);
+}
+
+cv::Mat EdgeCheckOperation::runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) {
+    // same edge density as edge count
+    cv::Mat gray = grayROI(input, roi);
+    double edge_density = static_cast<double>(countEdgePixels(gray)) / (gray.rows * gray.cols);
+    
+    // failed: an empty result switches off everything downstream
+    if (!isInRange(edge_density, static_cast<const Parameters&>(prepared))) {
+        return cv::Mat();
+    }
+    return input;
+}
+
+std::string EdgeCheckOperation::getNameImpl() const {
+    return "edge_check";
+}
+
+ROI EdgeCheckOperation::getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const {
+    // the checked roi plus whatever downstream reads from the passed-through image
+    return ROITools::unite(output_region, roi);
+}
+
+bool EdgeCheckOperation::isPredicateImpl() const {
+    return true;
+}
+
+bool EdgeCheckOperation::validateParametersImpl(const std::map<std::string, double>& parameters) const {
+    if (parameters.count("min") && (parameters.at("min") < 0.0 || parameters.at("min") > 1.0)) {
+        throw std::invalid_argument("edge check min must be between 0.0 and 1.0");
+    }
+    if (parameters.count("max") && (parameters.at("max") < 0.0 || parameters.at("max") > 1.0)) {
+        throw std::invalid_argument("edge check max must be between 0.0 and 1.0");
+    }
+    return validateRange(parameters, "edge check");
+}
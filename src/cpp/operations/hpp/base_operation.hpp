@@ -3,6 +3,8 @@
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 
 // region of interest structure
 struct ROI {
@@ -23,21 +25,108 @@ namespace ROITools {
     
     // apply processed roi back to original image
     cv::Mat applyROI(const cv::Mat& input, const cv::Mat& processed_roi, const ROI& roi);
+    
+    // write processed roi into the image itself (no full-image copy)
+    cv::Mat writeROI(cv::Mat& image, const cv::Mat& processed_roi, const ROI& roi);
+    
+    // region helpers (a region is a roi in image coordinates; it may reach past the
+    // image until it is clipped, and a zero-sized region means "nothing")
+    
+    // check if a region covers no pixels
+    bool isEmpty(const ROI& region);
+    
+    // check if two regions cover exactly the same pixels
+    bool isSame(const ROI& a, const ROI& b);
+    
+    // smallest region containing both regions
+    ROI unite(const ROI& a, const ROI& b);
+    
+    // region covered by both regions
+    ROI intersect(const ROI& a, const ROI& b);
+    
+    // grow a region by radius pixels on every side
+    ROI expand(const ROI& region, int radius);
+    
+    // clip a region to an image of the given size (never returns a full-image roi)
+    ROI clip(const ROI& region, const cv::Size& size);
+    
+    // move a region by (dx, dy)
+    ROI translate(const ROI& region, int dx, int dy);
 }
 
+// parameters of an operation, parsed and validated once by Operation::prepare so runs
+// need neither map lookups nor validation; every operation with parameters derives its
+// own typed block
+struct PreparedParameters {
+    virtual ~PreparedParameters() = default;
+    
+    std::map<std::string, double> parameters;   // the map it was prepared from (for the execution hooks)
+};
+
+using PreparedParametersPtr = std::shared_ptr<const PreparedParameters>;
+
 // base class for all image processing operations
 class Operation {
 public:
     virtual ~Operation() = default;
  
-    // public non-virtual interface - execute the operation on the input image
+    // public non-virtual interface - parse and validate parameters into the typed block
+    // the run methods take (throws std::runtime_error naming the reason if they are invalid)
+    PreparedParametersPtr prepare(const std::map<std::string, double>& params) const;
+ 
+    // public non-virtual interface - run the operation on the input image with parameters
+    // prepared by this operation (no lookups, no validation)
+    cv::Mat run(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared);
+ 
+    // public non-virtual interface - run the operation on an image the caller owns
+    // exclusively; its buffer may be overwritten and returned as the result
+    cv::Mat runInPlace(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared);
+ 
+    // public non-virtual interface - run the operation on roi of an exclusively owned
+    // image where only the pixels inside region (clipped to the image) are read afterwards;
+    // only valid for local operations
+    cv::Mat runRegion(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared);
+ 
+    // public non-virtual interface - execute the operation on the input image (the block
+    // prepared last is reused while params stay the same, prefer prepare() once and run())
     cv::Mat execute(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params);
  
+    // public non-virtual interface - execute the operation on an image the caller owns
+    // exclusively; its buffer may be overwritten and returned as the result
+    cv::Mat executeInPlace(cv::Mat& image, const ROI& roi, const std::map<std::string, double>& params);
+ 
+    // public non-virtual interface - execute the operation on roi of an exclusively owned
+    // image where only the pixels inside region (clipped to the image) are read afterwards;
+    // only valid for local operations
+    cv::Mat executeRegion(cv::Mat& image, const ROI& roi, const ROI& region, const std::map<std::string, double>& params);
+ 
     // public non-virtual interface - get the name/type of this operation
     std::string getName() const;
  
-    // public non-virtual interface - validate parameters for this operation
+    // public non-virtual interface - validate parameters for this operation (prints
+    // nothing, prepare() reports why they are invalid)
     bool validateParameters(const std::map<std::string, double>& parameters) const;
+ 
+    // public non-virtual interface - check if each output pixel depends only on the same
+    // input pixel (and not on its position), so chains can be fused into one lookup table
+    bool isPointwise() const;
+ 
+    // public non-virtual interface - check if running on a smaller roi produces the same
+    // pixels inside it, so the roi may be clipped to what downstream actually reads
+    bool isLocal() const;
+ 
+    // public non-virtual interface - check if the operation does more than compute its
+    // result (e.g. prints an analysis report)
+    bool hasSideEffects() const;
+ 
+    // public non-virtual interface - check if the operation is a predicate: it passes its
+    // input on while a condition holds and returns an empty image once it fails, which
+    // switches off everything downstream
+    bool isPredicate() const;
+ 
+    // public non-virtual interface - region of the input read to produce output_region
+    // of the result when the operation runs on roi
+    ROI getRequiredRegion(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& params) const;
 
 protected:
     // pre-execution validation hook
@@ -47,12 +136,46 @@ protected:
     virtual bool postExecute(const cv::Mat& input, const cv::Mat& output, const ROI& roi, const std::map<std::string, double>& params) const;
 
 private:
-    // private virtual interface - execute the operation implementation
-    virtual cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params) = 0;
+    // private virtual interface - parse validated parameters (defaults to an empty block
+    // for operations without parameters)
+    virtual std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& params) const;
+
+    // private virtual interface - run the operation implementation
+    virtual cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) = 0;
+
+    // private virtual interface - run the operation reusing the image buffer
+    // (defaults to the copying implementation)
+    virtual cv::Mat runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared);
+
+    // private virtual interface - run the operation where its result is read
+    // (defaults to running in place on the part of the roi inside the region)
+    virtual cv::Mat runRegionImpl(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared);
 
     // private virtual interface - get the name/type of this operation
     virtual std::string getNameImpl() const = 0;
 
-    // private virtual interface - validate parameters for this operation
+    // private virtual interface - validate parameters for this operation (throws
+    // std::invalid_argument with the reason, or returns false)
     virtual bool validateParametersImpl(const std::map<std::string, double>& parameters) const = 0;
+
+    // private virtual interface - pointwise check (operations are not pointwise by default)
+    virtual bool isPointwiseImpl() const;
+
+    // private virtual interface - locality check (operations are not local by default)
+    virtual bool isLocalImpl() const;
+
+    // private virtual interface - side effect check (operations are pure by default)
+    virtual bool hasSideEffectsImpl() const;
+
+    // private virtual interface - predicate check (operations are not predicates by default)
+    virtual bool isPredicateImpl() const;
+
+    // private virtual interface - required input region (defaults to the whole input)
+    virtual ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& params) const;
+
+    // block prepared by the last execute call, reused while its parameters stay the same
+    PreparedParametersPtr prepareCached(const std::map<std::string, double>& params);
+
+    std::mutex prepared_mutex_;              // guards last_prepared_
+    PreparedParametersPtr last_prepared_;    // block of the last execute call
 }; 
\ No newline at end of file
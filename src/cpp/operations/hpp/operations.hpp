@@ -1,61 +1,172 @@
 #pragma once
 
 #include "base_operation.hpp"
+#include <limits>
 
 // brightness adjustment operation (parameter: factor)
 class BrightnessOperation : public Operation {
+public:
+    // prepared parameters
+    struct Parameters : PreparedParameters {
+        double factor = 1.0;
+    };
+    
 private:
-    cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) override;
+    std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& parameters) const override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
+    cv::Mat runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) override;
     std::string getNameImpl() const override;
     bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    bool isPointwiseImpl() const override;
+    bool isLocalImpl() const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
 };
 
 // blur operation (parameters: kernel_size, sigma)
 class BlurOperation : public Operation {
+public:
+    // prepared parameters
+    struct Parameters : PreparedParameters {
+        int kernel_size = 5;     // odd
+        double sigma = 1.0;
+        cv::Mat kernel;          // separable gaussian coefficients (CV_32F), built once
+    };
+    
 private:
-    cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) override;
+    std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& parameters) const override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
+    cv::Mat runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) override;
+    cv::Mat runRegionImpl(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared) override;
     std::string getNameImpl() const override;
     bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    bool isLocalImpl() const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
 };
 
 // contrast adjustment operation (parameters: factor, brightness_offset)
 class ContrastOperation : public Operation {
+public:
+    // prepared parameters
+    struct Parameters : PreparedParameters {
+        double factor = 1.0;
+        double brightness_offset = 0.0;
+    };
+    
 private:
-    cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) override;
+    std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& parameters) const override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
+    cv::Mat runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) override;
     std::string getNameImpl() const override;
     bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    bool isPointwiseImpl() const override;
+    bool isLocalImpl() const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
 };
 
 // crop operation (parameters: x, y, width, height)
 class CropOperation : public Operation {
+public:
+    // prepared parameters (without a width or height the crop reaches the image border)
+    struct Parameters : PreparedParameters {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+        bool has_width = false;
+        bool has_height = false;
+    };
+    
 private:
-    cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) override;
+    std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& parameters) const override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
     std::string getNameImpl() const override;
     bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
 };
 
 // sharpen operation (parameters: strength, kernel_size)
 class SharpenOperation : public Operation {
+public:
+    // prepared parameters
+    struct Parameters : PreparedParameters {
+        double strength = 1.0;
+        int kernel_size = 5;     // odd
+        cv::Mat kernel;          // separable gaussian coefficients of the mask (CV_32F), built once
+    };
+    
 private:
-    cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) override;
+    std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& parameters) const override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
+    cv::Mat runInPlaceImpl(cv::Mat& image, const ROI& roi, const PreparedParameters& prepared) override;
+    cv::Mat runRegionImpl(cv::Mat& image, const ROI& roi, const ROI& region, const PreparedParameters& prepared) override;
     std::string getNameImpl() const override;
     bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    bool isLocalImpl() const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
 };
 
 // edge count analysis operation (no parameters)
 class EdgeCountOperation : public Operation {
+public:
+    // what the analysis reports
+    struct Statistics {
+        int edge_pixels = 0;          // pixels on a canny edge
+        double mean_magnitude = 0.0;  // mean 3x3 sobel gradient magnitude
+    };
+    
+    // edge statistics of a grayscale image
+    static Statistics measure(const cv::Mat& gray);
+    
 private:
-    cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
     std::string getNameImpl() const override;
     bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
+    bool hasSideEffectsImpl() const override;
 };
 
 // blur detection analysis operation (no parameters)
 class BlurDetectionOperation : public Operation {
 private:
-    cv::Mat executeImpl(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& parameters) override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
     std::string getNameImpl() const override;
     bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
+    bool hasSideEffectsImpl() const override;
 };
 
- 
\ No newline at end of file
+// prepared min and max of a check predicate (both optional)
+struct RangeParameters : PreparedParameters {
+    double min = -std::numeric_limits<double>::infinity();
+    double max = std::numeric_limits<double>::infinity();
+};
+
+// blur check predicate (parameters: min, max, reject); passes the image on while the
+// variance of the laplacian lies in [min, max]
+class BlurCheckOperation : public Operation {
+public:
+    using Parameters = RangeParameters;
+    
+private:
+    std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& parameters) const override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
+    std::string getNameImpl() const override;
+    bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
+    bool isPredicateImpl() const override;
+};
+
+// edge check predicate (parameters: min, max, reject); passes the image on while the
+// fraction of canny edge pixels lies in [min, max]
+class EdgeCheckOperation : public Operation {
+public:
+    using Parameters = RangeParameters;
+    
+private:
+    std::shared_ptr<PreparedParameters> prepareImpl(const std::map<std::string, double>& parameters) const override;
+    cv::Mat runImpl(const cv::Mat& input, const ROI& roi, const PreparedParameters& prepared) override;
+    std::string getNameImpl() const override;
+    bool validateParametersImpl(const std::map<std::string, double>& parameters) const override;
+    ROI getRequiredRegionImpl(const ROI& output_region, const ROI& roi, const std::map<std::string, double>& parameters) const override;
+    bool isPredicateImpl() const override;
+};
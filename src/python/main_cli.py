@@ -50,6 +50,22 @@ OPERATIONS = [
     {
         "name": "blur_detection",
         "params": []
+    },
+    {
+        "name": "blur_check",
+        "params": [
+            {"name": "min", "type": float, "prompt": "minimum laplacian variance (default: none)", "default": None},
+            {"name": "max", "type": float, "prompt": "maximum laplacian variance (default: none)", "default": None},
+            {"name": "reject", "type": int, "prompt": "reject the frame when the check fails (0 or 1, default 0)", "default": 0}
+        ]
+    },
+    {
+        "name": "edge_check",
+        "params": [
+            {"name": "min", "type": float, "prompt": "minimum edge density (0.0-1.0, default: none)", "default": None},
+            {"name": "max", "type": float, "prompt": "maximum edge density (0.0-1.0, default: none)", "default": None},
+            {"name": "reject", "type": int, "prompt": "reject the frame when the check fails (0 or 1, default 0)", "default": 0}
+        ]
     }
 ]
 
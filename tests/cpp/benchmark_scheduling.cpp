@@ -0,0 +1,310 @@
+#include "graph/hpp/graph_executor.hpp"
+#include "operations/hpp/operations.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// timings of scheduling options on the same graphs (not run by ctest: the numbers depend
+// on the machine, compare them side by side)
+namespace {
+    // node of a benchmark graph (full-image roi)
+    NodeConfig makeNode(const std::string& id, const std::string& type, const std::map<std::string, double>& parameters = {}) {
+        NodeConfig node;
+        node.id = id;
+        node.name = id;
+        node.type = type;
+        node.parameters = parameters;
+        node.roi = ROI(0, 0, 0, 0, true);
+        return node;
+    }
+
+    // one long chain of wide filters next to several one-node branches, all reading the
+    // input; a scheduler that starts the short branches first leaves the chain for last
+    GraphConfig unbalancedGraph(int branches) {
+        GraphConfig config;
+        config.nodes.push_back(makeNode("in", "input"));
+        std::string previous = "in";
+        for (int i = 0; i < 4; ++i) {
+            std::string id = "chain" + std::to_string(i);
+            config.nodes.push_back(makeNode(id, "sharpen", {{"strength", 0.5}, {"kernel_size", 15}}));
+            config.connections.emplace_back(previous, 0, id, 0);
+            previous = id;
+        }
+        config.nodes.push_back(makeNode("out", "output"));
+        config.connections.emplace_back(previous, 0, "out", 0);
+        for (int i = 0; i < branches; ++i) {
+            std::string id = "branch" + std::to_string(i);
+            config.nodes.push_back(makeNode(id, "blur", {{"kernel_size", 9}, {"sigma", 2.0}}));
+            config.connections.emplace_back("in", 0, id, 0);
+            config.nodes.push_back(makeNode(id + "_out", "output"));
+            config.connections.emplace_back(id, 0, id + "_out", 0);
+        }
+        return config;
+    }
+
+    // width independent blur branches off the input, each depth nodes long
+    GraphConfig syntheticGraph(int width, int depth) {
+        GraphConfig config;
+        config.nodes.push_back(makeNode("in", "input"));
+        for (int b = 0; b < width; ++b) {
+            std::string previous = "in";
+            for (int d = 0; d < depth; ++d) {
+                std::string id = "n" + std::to_string(b) + "_" + std::to_string(d);
+                config.nodes.push_back(makeNode(id, "blur", {{"kernel_size", 7}, {"sigma", 1.5}}));
+                config.connections.emplace_back(previous, 0, id, 0);
+                previous = id;
+            }
+            config.nodes.push_back(makeNode("out" + std::to_string(b), "output"));
+            config.connections.emplace_back(previous, 0, "out" + std::to_string(b), 0);
+        }
+        return config;
+    }
+    
+    // a recipe of node_count nodes: every node reads one of the few nodes before it, so
+    // the graph branches and joins levels without growing too deep
+    GraphConfig largeGraph(int node_count) {
+        GraphConfig config;
+        config.nodes.push_back(makeNode("in", "input"));
+        cv::RNG rng(node_count);
+        for (int i = 1; i < node_count; ++i) {
+            std::string id = "n" + std::to_string(i);
+            config.nodes.push_back(makeNode(id, "blur", {{"kernel_size", 3}, {"sigma", 1.0}}));
+            int source = std::max(0, i - 1 - rng.uniform(0, 8));
+            config.connections.emplace_back(source == 0 ? "in" : "n" + std::to_string(source), 0, id, 0);
+        }
+        return config;
+    }
+    
+    // a chain of filters and pointwise stages that compiles into one tiled chain
+    GraphConfig filterChainGraph() {
+        GraphConfig config;
+        const std::vector<NodeConfig> stages = {
+            makeNode("blur", "blur", {{"kernel_size", 5}, {"sigma", 1.2}}),
+            makeNode("sharpen", "sharpen", {{"strength", 1.2}, {"kernel_size", 3}}),
+            makeNode("bright", "brightness", {{"factor", 1.2}}),
+            makeNode("contrast", "contrast", {{"factor", 1.4}, {"brightness_offset", -25}}),
+            makeNode("wide_blur", "blur", {{"kernel_size", 9}, {"sigma", 2.5}}),
+            makeNode("wide_sharpen", "sharpen", {{"strength", 0.6}, {"kernel_size", 7}})
+        };
+        config.nodes.push_back(makeNode("in", "input"));
+        std::string previous = "in";
+        for (const NodeConfig& stage : stages) {
+            config.nodes.push_back(stage);
+            config.connections.emplace_back(previous, 0, stage.id, 0);
+            previous = stage.id;
+        }
+        config.nodes.push_back(makeNode("out", "output"));
+        config.connections.emplace_back(previous, 0, "out", 0);
+        return config;
+    }
+    
+    // median time of one frame in ms, after a few warm-up frames
+    double medianFrameMs(const GraphExecutor& executor, const cv::Mat& frame, int frames = 30) {
+        ExecutionContext context;
+        context.setOutputCapture(true);
+        std::vector<double> times;
+        for (int i = 0; i < frames + 5; ++i) {
+            context.setInput("in", frame);
+            auto start = std::chrono::steady_clock::now();
+            executor.execute(context);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (i >= 5) {
+                times.push_back(elapsed.count());
+            }
+        }
+        std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        return times[times.size() / 2];
+    }
+
+    // an executor for the graph, configured by setup
+    double benchmark(const GraphConfig& graph, const cv::Mat& frame, const std::function<void(GraphExecutor&)>& setup) {
+        GraphExecutor executor;
+        setup(executor);
+        executor.loadGraph(graph);
+        return medianFrameMs(executor, frame);
+    }
+
+    // the dataflow scheduler against the serial loop on wide and on deep graphs
+    void benchmarkDataflow(const cv::Mat& frame) {
+        std::cout << "dataflow vs sequential (median ms per frame)" << std::endl;
+        struct Shape {
+            const char* name;
+            int width;
+            int depth;
+        };
+        const Shape shapes[] = {{"wide (16 x 2): ", 16, 2}, {"deep (2 x 16): ", 2, 16}};
+        for (const Shape& shape : shapes) {
+            double sequential = benchmark(syntheticGraph(shape.width, shape.depth), frame, [](GraphExecutor& executor) {
+                executor.setExecutionMode(ExecutionMode::Sequential);
+            });
+            std::cout << "  " << shape.name << "sequential:         " << sequential << std::endl;
+            for (size_t threads : {2, 4}) {
+                double ms = benchmark(syntheticGraph(shape.width, shape.depth), frame, [&](GraphExecutor& executor) {
+                    executor.setExecutionMode(ExecutionMode::Dataflow);
+                    executor.setThreadCount(threads);
+                });
+                std::cout << "  " << shape.name << "dataflow, " << threads << " threads: " << ms << std::endl;
+            }
+        }
+    }
+    
+    // time to load a recipe (build, validate and compile the plan), which should grow
+    // linearly with the node count
+    void benchmarkGraphLoad() {
+        std::cout << "graph load (median ms per load)" << std::endl;
+        for (int node_count : {1000, 10000}) {
+            GraphConfig config = largeGraph(node_count);
+            std::vector<double> times;
+            for (int i = 0; i < 7; ++i) {
+                GraphExecutor executor;
+                auto start = std::chrono::steady_clock::now();
+                executor.loadGraph(config);
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                times.push_back(elapsed.count());
+            }
+            std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+            double ms = times[times.size() / 2];
+            std::cout << "  " << node_count << " nodes: " << ms << " (" << ms * 1000.0 / node_count << " us per node)" << std::endl;
+        }
+    }
+    
+    // tiled chains over a range of tile sizes around the default of sea_vision --tiled
+    void benchmarkTileSize(const cv::Mat& frame) {
+        std::cout << "tile size (filter chain, median ms per frame)" << std::endl;
+        for (size_t threads : {1, 4}) {
+            for (int tile_size : {0, 128, 256, GraphExecutor::default_tile_size, 1024, 2048}) {
+                double ms = benchmark(filterChainGraph(), frame, [&](GraphExecutor& executor) {
+                    executor.setThreadCount(threads);
+                    executor.setTileSize(tile_size);
+                });
+                std::cout << "  " << threads << " threads, ";
+                if (tile_size == 0) {
+                    std::cout << "untiled: ";
+                } else {
+                    std::cout << tile_size << (tile_size == GraphExecutor::default_tile_size ? " (default): " : ": ");
+                }
+                std::cout << ms << std::endl;
+            }
+        }
+    }
+    
+    // median time of one call of run in ms, after a few warm-up calls
+    double medianCallMs(const std::function<void()>& run, int calls = 50) {
+        std::vector<double> times;
+        for (int i = 0; i < calls + 5; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (i >= 5) {
+                times.push_back(elapsed.count());
+            }
+        }
+        std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        return times[times.size() / 2];
+    }
+    
+    // the vectorized brightness pass against the float round trip it replaced
+    // (convertTo, scale, convertTo and two thresholds)
+    void benchmarkBrightness(const cv::Mat& frame) {
+        std::cout << "brightness (full frame, median ms per call)" << std::endl;
+        BrightnessOperation brightness;
+        PreparedParametersPtr prepared = brightness.prepare({{"factor", 1.3}});
+        cv::Mat gray;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        for (const cv::Mat& image : {frame, gray}) {
+            const char* name = image.channels() == 3 ? "8UC3: " : "8UC1: ";
+            cv::Mat output;
+            double vectorized = medianCallMs([&]() {
+                output = brightness.run(image, ROI(0, 0, 0, 0, true), *prepared);
+            });
+            double round_trip = medianCallMs([&]() {
+                cv::Mat float_img;
+                image.convertTo(float_img, CV_32F);
+                float_img *= 1.3;
+                float_img.convertTo(output, image.type());
+                cv::threshold(output, output, 255, 255, cv::THRESH_TRUNC);
+                cv::threshold(output, output, 0, 0, cv::THRESH_TOZERO);
+            });
+            std::cout << "  " << name << "vectorized: " << vectorized << ", convertTo/threshold: " << round_trip << std::endl;
+        }
+    }
+    
+    // dataflow work stealing against dispatch by upward rank
+    void benchmarkCriticalPath(const cv::Mat& frame) {
+        std::cout << "critical path (dataflow, unbalanced graph, median ms per frame)" << std::endl;
+        for (size_t threads : {2, 4}) {
+            for (bool critical_path : {false, true}) {
+                double ms = benchmark(unbalancedGraph(6), frame, [&](GraphExecutor& executor) {
+                    executor.setExecutionMode(ExecutionMode::Dataflow);
+                    executor.setThreadCount(threads);
+                    executor.setCriticalPathSchedulingEnabled(critical_path);
+                });
+                std::cout << "  " << threads << " threads, " << (critical_path ? "by rank:      " : "work stealing:")
+                          << " " << ms << std::endl;
+            }
+        }
+    }
+
+    // one kernel thread budget per run, sized from the expected concurrency, against fixed
+    // kernel widths (one thread per kernel, or OpenCV's own setting next to the workers)
+    void benchmarkKernelThreads(const cv::Mat& frame) {
+        std::cout << "kernel threads (4 threads, median ms per frame)" << std::endl;
+        struct Variant {
+            const char* name;
+            KernelThreading threading;
+        };
+        const Variant variants[] = {
+            {"adaptive: ", KernelThreading::Adaptive},
+            {"serial:   ", KernelThreading::Serial},
+            {"unmanaged:", KernelThreading::Unmanaged}
+        };
+        for (int branches : {0, 6}) {
+            for (ExecutionMode mode : {ExecutionMode::Parallel, ExecutionMode::Dataflow}) {
+                for (const Variant& variant : variants) {
+                    double ms = benchmark(unbalancedGraph(branches), frame, [&](GraphExecutor& executor) {
+                        executor.setExecutionMode(mode);
+                        executor.setThreadCount(4);
+                        executor.setKernelThreading(variant.threading);
+                    });
+                    std::cout << "  " << (branches == 0 ? "chain only, " : "unbalanced, ")
+                              << (mode == ExecutionMode::Parallel ? "parallel, " : "dataflow, ")
+                              << variant.name << " " << ms << std::endl;
+                }
+            }
+        }
+    }
+}
+
+// run every benchmark (or those whose name contains argv[1])
+int main(int argc, char* argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    cv::Mat frame(1080, 1920, CV_8UC3);
+    cv::randu(frame, 0, 256);
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+
+    if (std::string("dataflow").find(filter) != std::string::npos) {
+        benchmarkDataflow(frame);
+    }
+    if (std::string("graph_load").find(filter) != std::string::npos) {
+        benchmarkGraphLoad();
+    }
+    if (std::string("tile_size").find(filter) != std::string::npos) {
+        benchmarkTileSize(frame);
+    }
+    if (std::string("brightness").find(filter) != std::string::npos) {
+        benchmarkBrightness(frame);
+    }
+    if (std::string("critical_path").find(filter) != std::string::npos) {
+        benchmarkCriticalPath(frame);
+    }
+    if (std::string("kernel_threads").find(filter) != std::string::npos) {
+        benchmarkKernelThreads(frame);
+    }
+    return 0;
+}
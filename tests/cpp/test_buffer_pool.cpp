@@ -0,0 +1,58 @@
+#include "test_runner.hpp"
+#include "graph/hpp/buffer_pool.hpp"
+#include <opencv2/opencv.hpp>
+#include <thread>
+
+TEST_CASE(pool_serves_only_scoped_threads) {
+    ScopedBufferPool scope;
+    cv::Mat pooled(64, 64, CV_8UC1);
+    CHECK(pooled.u->currAllocator == &BufferPool::instance());
+    
+    // another thread keeps the allocator it had, unless it joins the scope
+    const cv::MatAllocator* outside = nullptr;
+    const cv::MatAllocator* inside = nullptr;
+    std::thread thread([&]() {
+        cv::Mat image(64, 64, CV_8UC1);
+        outside = image.u->currAllocator;
+        BufferPoolThreadScope joined;
+        cv::Mat joined_image(64, 64, CV_8UC1);
+        inside = joined_image.u->currAllocator;
+    });
+    thread.join();
+    CHECK(outside != &BufferPool::instance());
+    CHECK(inside == &BufferPool::instance());
+}
+
+TEST_CASE(pool_evicts_least_recently_used_sizes) {
+    BufferPool& pool = BufferPool::instance();
+    pool.trim();
+    size_t capacity = pool.getCapacity();
+    pool.setCapacity(3 * 1000 * 1000);
+    
+    size_t reused = pool.getReusedAllocationCount();
+    {
+        ScopedBufferPool scope;
+        
+        // 1 MB and 2 MB cached, then 1 MB is used again and 1.5 MB more pushes the cache
+        // past its capacity: the 2 MB size, used least recently, goes
+        {
+            cv::Mat small(1000, 1000, CV_8UC1);
+            cv::Mat large(2000, 1000, CV_8UC1);
+        }
+        CHECK_EQUAL(pool.getCachedBytes(), size_t(3000000));
+        {
+            cv::Mat small(1000, 1000, CV_8UC1);
+            cv::Mat medium(1500, 1000, CV_8UC1);
+        }
+        CHECK_EQUAL(pool.getCachedBytes(), size_t(2500000));
+        CHECK_EQUAL(pool.getReusedAllocationCount(), reused + 1);
+        
+        cv::Mat medium(1500, 1000, CV_8UC1);
+        cv::Mat small(1000, 1000, CV_8UC1);
+        CHECK_EQUAL(pool.getReusedAllocationCount(), reused + 3);
+    }
+    
+    pool.setCapacity(capacity);
+    pool.trim();
+    CHECK_EQUAL(pool.getCachedBytes(), size_t(0));
+}
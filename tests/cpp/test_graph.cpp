@@ -0,0 +1,922 @@
+#include "test_runner.hpp"
+#include "graph/hpp/graph.hpp"
+#include "graph/hpp/graph_executor.hpp"
+#include "graph/hpp/graph_node_factory.hpp"
+#include "graph/hpp/spsc_queue.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    // node of a test graph (full-image roi unless given)
+    NodeConfig makeNode(const std::string& id, const std::string& type,
+                        const std::map<std::string, double>& parameters = {},
+                        const ROI& roi = ROI(0, 0, 0, 0, true)) {
+        NodeConfig node;
+        node.id = id;
+        node.name = id;
+        node.type = type;
+        node.parameters = parameters;
+        node.roi = roi;
+        return node;
+    }
+    
+    // graph from nodes and (from, to) edges
+    GraphConfig makeGraph(const std::vector<NodeConfig>& nodes, const std::vector<std::pair<std::string, std::string>>& edges) {
+        GraphConfig config;
+        config.nodes = nodes;
+        for (const auto& edge : edges) {
+            config.connections.emplace_back(edge.first, 0, edge.second, 0);
+        }
+        return config;
+    }
+    
+    // a pointwise chain, local filters with and without a roi, a crop and a fan-out whose
+    // branches run concurrently; "out" (the result) reads the longer branch
+    GraphConfig branchingGraph() {
+        return makeGraph({
+            makeNode("in", "input"),
+            makeNode("bright", "brightness", {{"factor", 1.3}}),
+            makeNode("contrast", "contrast", {{"factor", 1.2}, {"brightness_offset", -10}}),
+            makeNode("blur", "blur", {{"kernel_size", 7}, {"sigma", 1.5}}, ROI(40, 30, 300, 200)),
+            makeNode("sharpen", "sharpen", {{"strength", 0.8}, {"kernel_size", 5}}),
+            makeNode("crop", "crop", {{"x", 20}, {"y", 10}, {"width", 400}, {"height", 300}}),
+            makeNode("side_blur", "blur", {{"kernel_size", 5}, {"sigma", 1.0}}),
+            makeNode("side_sharpen", "sharpen", {{"strength", 1.5}, {"kernel_size", 3}}, ROI(10, 10, 200, 150)),
+            makeNode("out", "output"),
+            makeNode("side_out", "output")
+        }, {
+            {"in", "bright"}, {"bright", "contrast"}, {"contrast", "blur"}, {"blur", "sharpen"},
+            {"sharpen", "crop"}, {"crop", "out"},
+            {"contrast", "side_blur"}, {"side_blur", "side_sharpen"}, {"side_sharpen", "side_out"}
+        });
+    }
+    
+    // pointwise runs that saturate at both ends, one behind a roi and one behind a filter
+    GraphConfig pointwiseGraph() {
+        return makeGraph({
+            makeNode("in", "input"),
+            makeNode("dark", "brightness", {{"factor", 0.4}}, ROI(30, 20, 250, 180)),
+            makeNode("stretch", "contrast", {{"factor", 2.5}, {"brightness_offset", -60}}),
+            makeNode("lift", "brightness", {{"factor", 1.7}}),
+            makeNode("blur", "blur", {{"kernel_size", 3}, {"sigma", 0.8}}),
+            makeNode("flatten", "contrast", {{"factor", 0.6}, {"brightness_offset", 40}}),
+            makeNode("boost", "brightness", {{"factor", 1.1}}),
+            makeNode("out", "output")
+        }, {
+            {"in", "dark"}, {"dark", "stretch"}, {"stretch", "lift"}, {"lift", "blur"},
+            {"blur", "flatten"}, {"flatten", "boost"}, {"boost", "out"}
+        });
+    }
+    
+    // a filter chain long enough to tile, with pointwise stages among the filters, read
+    // through a crop so only part of it is needed downstream
+    GraphConfig filterChainGraph() {
+        return makeGraph({
+            makeNode("in", "input"),
+            makeNode("blur", "blur", {{"kernel_size", 5}, {"sigma", 1.2}}),
+            makeNode("sharpen", "sharpen", {{"strength", 1.2}, {"kernel_size", 3}}),
+            makeNode("bright", "brightness", {{"factor", 1.2}}),
+            makeNode("contrast", "contrast", {{"factor", 1.4}, {"brightness_offset", -25}}),
+            makeNode("wide_blur", "blur", {{"kernel_size", 9}, {"sigma", 2.5}}),
+            makeNode("wide_sharpen", "sharpen", {{"strength", 0.6}, {"kernel_size", 7}}),
+            makeNode("crop", "crop", {{"x", 101}, {"y", 57}, {"width", 333}, {"height", 271}}),
+            makeNode("out", "output")
+        }, {
+            {"in", "blur"}, {"blur", "sharpen"}, {"sharpen", "bright"}, {"bright", "contrast"},
+            {"contrast", "wide_blur"}, {"wide_blur", "wide_sharpen"}, {"wide_sharpen", "crop"}, {"crop", "out"}
+        });
+    }
+    
+    // a blurred random frame, so filters and checks see structure instead of pure noise
+    cv::Mat testFrame(int width = 640, int height = 480, int seed = 1) {
+        cv::Mat frame(height, width, CV_8UC3);
+        cv::RNG rng(seed);
+        rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+        cv::GaussianBlur(frame, frame, cv::Size(7, 7), 2.0);
+        return frame;
+    }
+    
+    // run one frame on its own context, keeping what the output nodes would save
+    cv::Mat runFrame(const GraphExecutor& executor, const cv::Mat& frame) {
+        ExecutionContext context;
+        context.setOutputCapture(true);
+        context.setInput("in", frame);
+        return executor.execute(context).clone();
+    }
+    
+    // same size, type and pixels
+    bool identical(const cv::Mat& a, const cv::Mat& b) {
+        return a.size() == b.size() && a.type() == b.type() && (a.empty() || cv::norm(a, b, cv::NORM_INF) == 0);
+    }
+    
+    // a graph of blur nodes with the given ids, connected by port 0 connections
+    void addBlurNodes(Graph& graph, const std::vector<std::string>& ids) {
+        for (const auto& id : ids) {
+            graph.addNode(GraphNodeFactory::createNode(id, "blur", {{"kernel_size", 3}, {"sigma", 1.0}}));
+        }
+    }
+    
+    // levels with every level in id order, as the graph keeps them
+    ExecutionLevels sortedLevels(ExecutionLevels levels) {
+        for (auto& level : levels) {
+            std::sort(level.begin(), level.end());
+        }
+        return levels;
+    }
+    
+    // the maintained levels match a fresh kahn sort of the same graph
+    bool levelsMatchFreshSort(const Graph& graph) {
+        return graph.getExecutionLevels() == sortedLevels(graph.topologicalSort());
+    }
+}
+
+TEST_CASE(parallel_and_dataflow_match_sequential) {
+    cv::Mat frame = testFrame();
+    GraphExecutor sequential;
+    sequential.loadGraph(branchingGraph());
+    cv::Mat expected = runFrame(sequential, frame);
+    CHECK_EQUAL(expected.size(), cv::Size(400, 300));
+    
+    for (ExecutionMode mode : {ExecutionMode::Parallel, ExecutionMode::Dataflow}) {
+        for (size_t threads : {1, 2, 4}) {
+            GraphExecutor executor;
+            executor.setThreadCount(threads);
+            executor.setExecutionMode(mode);
+            executor.loadGraph(branchingGraph());
+            
+            // later runs are ordered by the costs measured in the first ones
+            for (int run = 0; run < 3; ++run) {
+                CHECK(identical(runFrame(executor, frame), expected));
+            }
+        }
+    }
+}
+
+TEST_CASE(concurrent_contexts_match_sequential) {
+    std::vector<cv::Mat> frames;
+    std::vector<cv::Mat> expected;
+    GraphExecutor executor;
+    executor.setExecutionMode(ExecutionMode::Dataflow);
+    executor.setThreadCount(2);
+    executor.loadGraph(branchingGraph());
+    for (int i = 0; i < 4; ++i) {
+        frames.push_back(testFrame(640, 480, i + 1));
+        expected.push_back(runFrame(executor, frames.back()));
+    }
+    
+    // one context per thread on the same executor
+    std::vector<cv::Mat> results(frames.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        threads.emplace_back([&, i]() { results[i] = runFrame(executor, frames[i]); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (size_t i = 0; i < frames.size(); ++i) {
+        CHECK(identical(results[i], expected[i]));
+    }
+}
+
+TEST_CASE(stream_matches_single_frames) {
+    GraphExecutor executor;
+    executor.loadGraph(branchingGraph());
+    std::vector<cv::Mat> frames;
+    std::vector<cv::Mat> expected;
+    for (int i = 0; i < 6; ++i) {
+        frames.push_back(testFrame(640, 480, i + 1));
+        expected.push_back(runFrame(executor, frames.back()));
+    }
+    
+    // every frame comes out in order, as if it had run alone
+    for (size_t stages : {1, 2, 3}) {
+        StreamOptions options;
+        options.stage_count = stages;
+        options.queue_capacity = 2;
+        options.pin_threads = false;
+        size_t next_frame = 0;
+        std::vector<cv::Mat> results;
+        executor.executeStream(
+            [&](ExecutionContext& context) {
+                if (next_frame == frames.size()) {
+                    return false;
+                }
+                context.setOutputCapture(true);
+                context.setInput("in", frames[next_frame++]);
+                return true;
+            },
+            [&](ExecutionContext& context) { results.push_back(context.getResult().clone()); },
+            options);
+        
+        CHECK_EQUAL(results.size(), frames.size());
+        for (size_t i = 0; i < frames.size(); ++i) {
+            CHECK(identical(results[i], expected[i]));
+        }
+    }
+}
+
+TEST_CASE(no_fresh_allocations_after_warm_up) {
+    // the buffers held at once depend on which nodes and kernel stripes overlap, so a
+    // schedule that changes with timing (dataflow workers, ranks from measured costs,
+    // OpenCV's own threads) may still need one more now and then; these repeat exactly
+    cv::Mat frame = testFrame();
+    std::vector<std::pair<ExecutionMode, size_t>> schedules = {
+        {ExecutionMode::Sequential, 1}, {ExecutionMode::Parallel, 2}
+    };
+    for (const auto& schedule : schedules) {
+        GraphExecutor executor;
+        executor.setExecutionMode(schedule.first);
+        executor.setThreadCount(schedule.second);
+        executor.setCriticalPathSchedulingEnabled(false);
+        executor.setKernelThreading(KernelThreading::Serial);
+        executor.loadGraph(branchingGraph());
+        ExecutionContext context;
+        context.setOutputCapture(true);
+        
+        // the first runs fill the pool, from then on every buffer is a recycled one
+        for (int run = 0; run < 5; ++run) {
+            context.setInput("in", frame);
+            executor.execute(context);
+            if (run >= 2) {
+                CHECK_EQUAL(context.getStats().fresh_buffer_allocations, size_t(0));
+            }
+        }
+    }
+}
+
+TEST_CASE(geometry_change_trims_the_pool) {
+    GraphExecutor executor;
+    executor.loadGraph(branchingGraph());
+    ExecutionContext context;
+    context.setOutputCapture(true);
+    for (int run = 0; run < 2; ++run) {
+        context.setInput("in", testFrame(640, 480));
+        executor.execute(context);
+    }
+    CHECK(BufferPool::instance().getCachedBytes() > 0);
+    
+    // the first run at the new size drops every buffer cached for the old one
+    context.setInput("in", testFrame(800, 600));
+    executor.execute(context);
+    CHECK_EQUAL(BufferPool::instance().getCachedBytes(), size_t(0));
+    CHECK(context.getStats().fresh_buffer_allocations > 0);
+    
+    context.setInput("in", testFrame(800, 600));
+    executor.execute(context);
+    CHECK(BufferPool::instance().getCachedBytes() > 0);
+}
+
+TEST_CASE(fused_pointwise_chains_match_unfused) {
+    cv::Mat color = testFrame();
+    cv::Mat gray;
+    cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
+    cv::Mat deep;
+    color.convertTo(deep, CV_16U, 257.0);
+    
+    for (const GraphConfig& graph : {pointwiseGraph(), branchingGraph()}) {
+        GraphExecutor unfused;
+        unfused.setPointwiseFusionEnabled(false);
+        unfused.loadGraph(graph);
+        GraphExecutor fused;
+        fused.loadGraph(graph);
+        
+        // the chains really were merged into single plan nodes
+        ExecutionContext context;
+        context.setOutputCapture(true);
+        context.setInput("in", color);
+        fused.execute(context);
+        CHECK(context.getStats().total_nodes < static_cast<int>(graph.nodes.size()));
+        
+        // 8-bit images go through the composed table, others through the stages
+        for (const cv::Mat& frame : {color, gray, deep}) {
+            cv::Mat expected = runFrame(unfused, frame);
+            CHECK(!expected.empty());
+            CHECK(identical(runFrame(fused, frame), expected));
+        }
+    }
+}
+
+TEST_CASE(tiled_and_region_paths_match_plain_execution) {
+    cv::Mat color = testFrame();
+    cv::Mat gray;
+    cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
+    cv::Mat deep;
+    color.convertTo(deep, CV_16U, 257.0);
+    
+    // tile size (0 = untiled), region propagation, pointwise fusion
+    struct Variant {
+        int tile_size;
+        bool regions;
+        bool fusion;
+    };
+    std::vector<Variant> variants = {
+        {0, true, false}, {64, false, false}, {37, false, true}, {64, true, false}, {100, true, true}
+    };
+    
+    for (const GraphConfig& graph : {filterChainGraph(), branchingGraph()}) {
+        GraphExecutor plain;
+        plain.setPointwiseFusionEnabled(false);
+        plain.setRegionPropagationEnabled(false);
+        plain.loadGraph(graph);
+        
+        for (const Variant& variant : variants) {
+            GraphExecutor executor;
+            executor.setThreadCount(2);
+            executor.setTileSize(variant.tile_size);
+            executor.setRegionPropagationEnabled(variant.regions);
+            executor.setPointwiseFusionEnabled(variant.fusion);
+            executor.loadGraph(graph);
+            
+            // a tiled filter chain runs as one plan node
+            ExecutionContext context;
+            context.setOutputCapture(true);
+            context.setInput("in", color);
+            executor.execute(context);
+            CHECK(variant.tile_size == 0 || context.getStats().total_nodes < static_cast<int>(graph.nodes.size()));
+            
+            for (const cv::Mat& frame : {color, gray, deep}) {
+                cv::Mat expected = runFrame(plain, frame);
+                CHECK(!expected.empty());
+                CHECK(identical(runFrame(executor, frame), expected));
+            }
+        }
+    }
+}
+
+TEST_CASE(incremental_runs_keep_only_results_read_again) {
+    // file input and outputs, the way the default context runs a graph; the side branch
+    // runs next to the main chain under the concurrent schedulers
+    std::string output_path = cv::tempfile(".png");
+    std::string side_path = cv::tempfile(".png");
+    GraphConfig graph = makeGraph({
+        makeNode("in", "input"),
+        makeNode("blur", "blur", {{"kernel_size", 5}, {"sigma", 1.2}}),
+        makeNode("sharpen", "sharpen", {{"strength", 1.0}, {"kernel_size", 3}}),
+        makeNode("contrast", "contrast", {{"factor", 1.3}, {"brightness_offset", -20}}),
+        makeNode("out", "output"),
+        makeNode("side_blur", "blur", {{"kernel_size", 9}, {"sigma", 2.0}}),
+        makeNode("side_out", "output")
+    }, {
+        {"in", "blur"}, {"blur", "sharpen"}, {"sharpen", "contrast"}, {"contrast", "out"},
+        {"blur", "side_blur"}, {"side_blur", "side_out"}
+    });
+    graph.nodes[0].image_path = "data/input.jpg";
+    graph.nodes[4].image_path = output_path;
+    graph.nodes[6].image_path = side_path;
+    
+    GraphExecutor fresh;
+    fresh.loadGraph(graph);
+    fresh.getNode("sharpen")->setParameter("strength", 2.0);
+    cv::Mat expected = fresh.execute().clone();
+    
+    for (ExecutionMode mode : {ExecutionMode::Sequential, ExecutionMode::Parallel, ExecutionMode::Dataflow}) {
+        GraphExecutor executor;
+        executor.setExecutionMode(mode);
+        executor.setThreadCount(4);
+        executor.setIncrementalExecutionEnabled(true);
+        executor.loadGraph(graph);
+        executor.execute();
+        CHECK_EQUAL(executor.getExecutionStats().executed_nodes, 7);
+        
+        // only the output nodes run again, on the results kept for them
+        executor.execute();
+        CHECK_EQUAL(executor.getExecutionStats().executed_nodes, 2);
+        
+        // the first change reloads and reblurs the released input of the tuned node, every
+        // later change finds it kept
+        executor.getNode("sharpen")->setParameter("strength", 1.5);
+        executor.execute();
+        CHECK_EQUAL(executor.getExecutionStats().executed_nodes, 6);
+        executor.getNode("sharpen")->setParameter("strength", 2.0);
+        cv::Mat result = executor.execute().clone();
+        CHECK_EQUAL(executor.getExecutionStats().executed_nodes, 4);
+        CHECK(identical(result, expected));
+    }
+    std::remove(output_path.c_str());
+    std::remove(side_path.c_str());
+}
+
+TEST_CASE(concurrent_runs_may_not_write_the_same_files) {
+    std::string output_path = cv::tempfile(".png");
+    GraphConfig graph = branchingGraph();
+    for (NodeConfig& node : graph.nodes) {
+        if (node.type == "output") {
+            node.image_path = output_path;
+        }
+    }
+    GraphExecutor executor;
+    executor.loadGraph(graph);
+    cv::Mat frame = testFrame();
+    
+    // a second run starting while the first one saves files is refused, one that captures
+    // its outputs goes ahead
+    ExecutionContext writing;
+    writing.setInput("in", frame);
+    bool refused = false;
+    cv::Mat captured;
+    bool started = false;
+    executor.executeWithProgress(writing, [&](const std::string&, int, int) {
+        if (started) {
+            return;
+        }
+        started = true;
+        ExecutionContext other;
+        other.setInput("in", frame);
+        try {
+            executor.execute(other);
+        } catch (const std::runtime_error&) {
+            refused = true;
+        }
+        captured = runFrame(executor, frame);
+    });
+    CHECK(refused);
+    CHECK(identical(captured, writing.getResult()));
+    
+    // once the run is over, the next one may write
+    ExecutionContext next;
+    next.setInput("in", frame);
+    executor.execute(next);
+    std::remove(output_path.c_str());
+}
+
+TEST_CASE(single_edge_edits_keep_levels_of_a_fresh_sort) {
+    Graph graph;
+    addBlurNodes(graph, {"a", "b", "c", "d", "e"});
+    CHECK_EQUAL(graph.getExecutionLevels().size(), size_t(1));
+    
+    // each edge is added to a built graph, so depths are pushed forward incrementally:
+    // a shortcut that changes nothing, then one that deepens a whole chain
+    graph.addConnection("a", 0, "b", 0);
+    graph.addConnection("b", 0, "c", 0);
+    graph.addConnection("a", 0, "c", 0);
+    CHECK(levelsMatchFreshSort(graph));
+    graph.addConnection("d", 0, "e", 0);
+    graph.addConnection("c", 0, "d", 0);
+    CHECK(levelsMatchFreshSort(graph));
+    CHECK_EQUAL(graph.getExecutionLevels().size(), size_t(5));
+    
+    // removing an edge may make nodes shallower
+    graph.disconnectNodes("b", "c");
+    CHECK(levelsMatchFreshSort(graph));
+    CHECK_EQUAL(graph.getExecutionLevels().size(), size_t(4));
+    CHECK(graph.getIncomingConnections("c").size() == 1);
+    CHECK(graph.getOutgoingConnections("b").empty());
+    
+    // a node added to a built graph starts in the first level
+    addBlurNodes(graph, {"f"});
+    graph.connectNodes("e", "f");
+    CHECK(levelsMatchFreshSort(graph));
+}
+
+TEST_CASE(remove_node_prunes_the_connection_indices) {
+    Graph graph;
+    addBlurNodes(graph, {"a", "b", "c", "d"});
+    graph.beginUpdate();
+    graph.addConnection("a", 0, "b", 0);
+    graph.addConnection("b", 0, "c", 0);
+    graph.addConnection("a", 0, "d", 0);
+    graph.addConnection("c", 0, "d", 1);
+    graph.endUpdate();
+    CHECK(levelsMatchFreshSort(graph));
+    
+    CHECK(graph.removeNode("c"));
+    CHECK(graph.getOutgoingConnections("b").empty());
+    CHECK_EQUAL(graph.getIncomingConnections("d").size(), size_t(1));
+    CHECK_EQUAL(graph.getIncomingConnections("d")[0].from_node, std::string("a"));
+    CHECK_EQUAL(graph.getOutgoingConnections("a").size(), size_t(2));
+    CHECK(graph.getIncomingConnections("c").empty());
+    CHECK(graph.getOutgoingConnections("c").empty());
+    CHECK(levelsMatchFreshSort(graph));
+    CHECK_EQUAL(graph.getExecutionLevels().size(), size_t(2));
+    
+    // the pair can be linked again once the node is back
+    addBlurNodes(graph, {"c"});
+    graph.addConnection("b", 0, "c", 0);
+    CHECK_EQUAL(graph.getIncomingConnections("c").size(), size_t(1));
+    CHECK(levelsMatchFreshSort(graph));
+}
+
+TEST_CASE(an_edge_closing_a_cycle_falls_back_to_a_full_sort) {
+    Graph graph;
+    addBlurNodes(graph, {"a", "b", "c", "d"});
+    graph.addConnection("a", 0, "b", 0);
+    graph.addConnection("b", 0, "c", 0);
+    graph.addConnection("c", 0, "d", 0);
+    CHECK(levelsMatchFreshSort(graph));
+    CHECK(!graph.hasCycles());
+    
+    // the incremental update finds the cycle and leaves it to the sort, which reports it
+    graph.addConnection("d", 0, "b", 0);
+    CHECK(graph.hasCycles());
+    CHECK(graph.getExecutionLevels().empty());
+    CHECK(graph.topologicalSort().empty());
+    
+    // more edits keep sorting until one breaks the cycle
+    addBlurNodes(graph, {"e"});
+    graph.addConnection("a", 0, "e", 0);
+    CHECK(graph.getExecutionLevels().empty());
+    graph.disconnectNodes("d", "b");
+    CHECK(!graph.hasCycles());
+    CHECK(levelsMatchFreshSort(graph));
+    CHECK_EQUAL(graph.getExecutionLevels().size(), size_t(4));
+}
+
+TEST_CASE(repeated_inputs_are_served_from_the_result_cache) {
+    cv::Mat frame = testFrame();
+    GraphExecutor plain;
+    plain.loadGraph(branchingGraph());
+    cv::Mat expected = runFrame(plain, frame);
+    
+    GraphExecutor executor;
+    executor.setResultCacheBudget(64 << 20);
+    executor.loadGraph(branchingGraph());
+    ExecutionContext context;
+    context.setOutputCapture(true);
+    context.setInput("in", frame);
+    CHECK(identical(executor.execute(context), expected));
+    size_t computed = context.getStats().cache_misses;
+    CHECK(computed > 0);
+    CHECK_EQUAL(context.getStats().cache_hits, size_t(0));
+    
+    // the same pixels again (in another buffer): every cacheable node is a hit
+    context.setInput("in", frame.clone());
+    CHECK(identical(executor.execute(context), expected));
+    CHECK_EQUAL(context.getStats().cache_hits, computed);
+    CHECK_EQUAL(context.getStats().cache_misses, size_t(0));
+    
+    // other pixels miss everywhere
+    context.setInput("in", testFrame(640, 480, 2));
+    executor.execute(context);
+    CHECK_EQUAL(context.getStats().cache_hits, size_t(0));
+    CHECK_EQUAL(context.getStats().cache_misses, computed);
+}
+
+TEST_CASE(a_budget_below_one_result_evicts_it) {
+    cv::Mat frame = testFrame();
+    GraphExecutor plain;
+    plain.loadGraph(branchingGraph());
+    cv::Mat expected = runFrame(plain, frame);
+    
+    // every result of the graph is larger than the budget, so none stays cached
+    GraphExecutor executor;
+    executor.setResultCacheBudget(frame.total() * frame.elemSize() / 8);
+    executor.loadGraph(branchingGraph());
+    ExecutionContext context;
+    context.setOutputCapture(true);
+    for (int run = 0; run < 2; ++run) {
+        context.setInput("in", frame);
+        CHECK(identical(executor.execute(context), expected));
+        CHECK_EQUAL(context.getStats().cache_hits, size_t(0));
+        CHECK(context.getStats().cache_misses > 0);
+    }
+}
+
+TEST_CASE(failing_predicates_skip_only_their_downstream_subgraph) {
+    // a_out (the result) reads a branch without checks; each check guards two nodes
+    GraphConfig graph = makeGraph({
+        makeNode("in", "input"),
+        makeNode("side", "contrast", {{"factor", 1.2}, {"brightness_offset", -10}}),
+        makeNode("a_out", "output"),
+        makeNode("sharp_gate", "blur_check", {{"min", 1.0}}),
+        makeNode("sharp_blur", "blur", {{"kernel_size", 5}, {"sigma", 1.2}}),
+        makeNode("b_out", "output"),
+        makeNode("flat_gate", "edge_check", {{"max", 0.0}}),
+        makeNode("flat_bright", "brightness", {{"factor", 1.5}}),
+        makeNode("c_out", "output")
+    }, {
+        {"in", "side"}, {"side", "a_out"},
+        {"in", "sharp_gate"}, {"sharp_gate", "sharp_blur"}, {"sharp_blur", "b_out"},
+        {"in", "flat_gate"}, {"flat_gate", "flat_bright"}, {"flat_bright", "c_out"}
+    });
+    GraphExecutor reference;
+    reference.loadGraph(makeGraph({makeNode("in", "input"), makeNode("side", "contrast", {{"factor", 1.2}, {"brightness_offset", -10}}),
+                                   makeNode("a_out", "output")}, {{"in", "side"}, {"side", "a_out"}}));
+    
+    // a textured frame fails the flatness check, a flat one the sharpness check
+    cv::Mat frames[] = {testFrame(), cv::Mat(480, 640, CV_8UC3, cv::Scalar(90, 120, 150))};
+    for (ExecutionMode mode : {ExecutionMode::Sequential, ExecutionMode::Parallel, ExecutionMode::Dataflow}) {
+        GraphExecutor executor;
+        executor.setExecutionMode(mode);
+        executor.setThreadCount(4);
+        executor.loadGraph(graph);
+        for (const cv::Mat& frame : frames) {
+            ExecutionContext context;
+            context.setOutputCapture(true);
+            context.setInput("in", frame);
+            CHECK(identical(executor.execute(context), runFrame(reference, frame)));
+            CHECK_EQUAL(context.getStats().skipped_nodes, size_t(2));
+            CHECK(!context.getStats().rejected);
+            CHECK(context.getStats().rejected_by.empty());
+        }
+    }
+}
+
+TEST_CASE(a_rejecting_predicate_ends_the_frame) {
+    GraphConfig graph = makeGraph({
+        makeNode("in", "input"),
+        makeNode("side", "contrast", {{"factor", 1.2}, {"brightness_offset", -10}}),
+        makeNode("a_out", "output"),
+        makeNode("gate", "blur_check", {{"min", 1.0}, {"reject", 1}}),
+        makeNode("gated_blur", "blur", {{"kernel_size", 5}, {"sigma", 1.2}}),
+        makeNode("b_out", "output")
+    }, {
+        {"in", "side"}, {"side", "a_out"},
+        {"in", "gate"}, {"gate", "gated_blur"}, {"gated_blur", "b_out"}
+    });
+    GraphExecutor reference;
+    reference.loadGraph(makeGraph({makeNode("in", "input"), makeNode("side", "contrast", {{"factor", 1.2}, {"brightness_offset", -10}}),
+                                   makeNode("a_out", "output")}, {{"in", "side"}, {"side", "a_out"}}));
+    cv::Mat textured = testFrame();
+    cv::Mat flat(480, 640, CV_8UC3, cv::Scalar(90, 120, 150));
+    
+    for (ExecutionMode mode : {ExecutionMode::Sequential, ExecutionMode::Parallel, ExecutionMode::Dataflow}) {
+        GraphExecutor executor;
+        executor.setExecutionMode(mode);
+        executor.setThreadCount(4);
+        executor.loadGraph(graph);
+        ExecutionContext context;
+        context.setOutputCapture(true);
+        
+        // the flat frame fails the check: no result, even though its branch passed
+        context.setInput("in", flat);
+        CHECK(executor.execute(context).empty());
+        CHECK(context.getResult().empty());
+        CHECK(context.getStats().rejected);
+        CHECK_EQUAL(context.getStats().rejected_by, std::string("gate"));
+        
+        // the verdict is per frame: the next one runs every branch again
+        context.setInput("in", textured);
+        CHECK(identical(executor.execute(context), runFrame(reference, textured)));
+        CHECK(!context.getStats().rejected);
+        CHECK(context.getStats().rejected_by.empty());
+        CHECK_EQUAL(context.getStats().skipped_nodes, size_t(0));
+    }
+}
+
+TEST_CASE(check_ordering_leaves_verdicts_and_results_unchanged) {
+    // three independent rejecting checks of different cost and selectivity, next to a
+    // processing branch with a check of its own that only skips
+    GraphConfig graph = makeGraph({
+        makeNode("in", "input"),
+        makeNode("not_flat", "blur_check", {{"min", 1.0}, {"reject", 1}}),
+        makeNode("not_noise", "blur_check", {{"max", 1000.0}, {"reject", 1}}),
+        makeNode("few_edges", "edge_check", {{"max", 0.1}, {"reject", 1}}),
+        makeNode("contrast", "contrast", {{"factor", 1.3}, {"brightness_offset", -15}}),
+        makeNode("blur", "blur", {{"kernel_size", 5}, {"sigma", 1.2}}),
+        makeNode("a_out", "output"),
+        makeNode("some_edges", "edge_check", {{"min", 0.0001}}),
+        makeNode("b_out", "output")
+    }, {
+        {"in", "not_flat"}, {"in", "not_noise"}, {"in", "few_edges"},
+        {"in", "contrast"}, {"contrast", "blur"}, {"blur", "a_out"},
+        {"in", "some_edges"}, {"some_edges", "b_out"}
+    });
+    
+    // textured frames pass, flat ones fail one check, noise fails two
+    cv::Mat noise(480, 640, CV_8UC3);
+    cv::RNG(3).fill(noise, cv::RNG::UNIFORM, 0, 256);
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < 12; ++i) {
+        if (i % 3 == 0) {
+            frames.push_back(testFrame(640, 480, i + 1));
+        } else if (i % 3 == 1) {
+            frames.push_back(cv::Mat(480, 640, CV_8UC3, cv::Scalar(20 * i, 100, 150)));
+        } else {
+            frames.push_back(noise);
+        }
+    }
+    
+    for (ExecutionMode mode : {ExecutionMode::Sequential, ExecutionMode::Parallel, ExecutionMode::Dataflow}) {
+        GraphExecutor unordered;
+        unordered.setExecutionMode(mode);
+        unordered.setThreadCount(4);
+        unordered.setCheckOrderingEnabled(false);
+        unordered.loadGraph(graph);
+        GraphExecutor ordered;
+        ordered.setExecutionMode(mode);
+        ordered.setThreadCount(4);
+        ordered.loadGraph(graph);
+        
+        // later frames are ordered by what the earlier ones measured
+        ExecutionContext unordered_context;
+        ExecutionContext ordered_context;
+        unordered_context.setOutputCapture(true);
+        ordered_context.setOutputCapture(true);
+        for (size_t i = 0; i < frames.size(); ++i) {
+            unordered_context.setInput("in", frames[i]);
+            ordered_context.setInput("in", frames[i]);
+            cv::Mat expected = unordered.execute(unordered_context).clone();
+            CHECK(identical(ordered.execute(ordered_context), expected));
+            
+            const ExecutionStats& stats = ordered_context.getStats();
+            CHECK_EQUAL(stats.rejected, unordered_context.getStats().rejected);
+            CHECK_EQUAL(stats.rejected, i % 3 != 0);
+            if (i % 3 == 1) {
+                CHECK_EQUAL(stats.rejected_by, std::string("not_flat"));
+            } else if (i % 3 == 2) {
+                CHECK(stats.rejected_by == "not_noise" || stats.rejected_by == "few_edges");
+            }
+        }
+        CHECK(ordered.getCheckStatistics("not_flat").getSampleCount() > 0);
+        CHECK(ordered.getCheckStatistics("few_edges").getSampleCount() > 0);
+        CHECK_EQUAL(ordered.getCheckStatistics("contrast").getSampleCount(), size_t(0));
+    }
+}
+
+TEST_CASE(spsc_queue_hands_over_every_item_in_order) {
+    // a tiny queue keeps both sides going to sleep, so a lost wake-up would hang here
+    for (size_t capacity : {1, 2, 8}) {
+        SpscQueue queue(capacity);
+        std::atomic<bool> cancelled(false);
+        const size_t count = 100000;
+        std::thread producer([&]() {
+            for (size_t i = 0; i < count; ++i) {
+                queue.push(i, cancelled);
+            }
+        });
+        bool in_order = true;
+        for (size_t i = 0; i < count; ++i) {
+            size_t item = 0;
+            in_order = queue.pop(item, cancelled) && item == i && in_order;
+        }
+        producer.join();
+        CHECK(in_order);
+        
+        // cancelling wakes a consumer sleeping on the empty queue
+        bool popped = true;
+        std::thread consumer([&]() {
+            size_t item = 0;
+            popped = queue.pop(item, cancelled);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        cancelled.store(true);
+        queue.wake();
+        consumer.join();
+        CHECK(!popped);
+    }
+}
+
+TEST_CASE(batches_match_single_frames_in_order) {
+    GraphExecutor executor;
+    executor.loadGraph(branchingGraph());
+    
+    // lossless files, each a different frame, with an input that does not exist among them
+    std::vector<cv::Mat> expected;
+    std::vector<BatchItem> items;
+    for (int i = 0; i < 6; ++i) {
+        BatchItem item;
+        item.input_path = cv::tempfile(".png");
+        item.output_path = cv::tempfile(".png");
+        if (i == 2) {
+            expected.push_back(cv::Mat());
+        } else {
+            cv::Mat frame = testFrame(640, 480, i + 1);
+            cv::imwrite(item.input_path, frame);
+            expected.push_back(runFrame(executor, frame));
+        }
+        items.push_back(item);
+    }
+    
+    // fewer images than workers, one at a time, and several at a time with short queues
+    struct Variant {
+        size_t images;
+        size_t parallel_images;
+        size_t prefetch;
+        size_t write_behind;
+    };
+    const Variant variants[] = {{2, 8, 4, 4}, {6, 1, 4, 4}, {6, 3, 1, 1}, {6, 0, 4, 4}};
+    for (const Variant& variant : variants) {
+        std::vector<BatchItem> batch(items.begin(), items.begin() + variant.images);
+        BatchOptions options;
+        options.parallel_images = variant.parallel_images;
+        options.prefetch = variant.prefetch;
+        options.write_behind = variant.write_behind;
+        BatchStats stats = executor.executeBatch(batch, options);
+        
+        size_t missing = variant.images > 2 ? 1 : 0;
+        CHECK_EQUAL(stats.images, variant.images);
+        CHECK_EQUAL(stats.saved, variant.images - missing);
+        CHECK_EQUAL(stats.failed, missing);
+        CHECK_EQUAL(stats.rejected, size_t(0));
+        CHECK_EQUAL(stats.failures.size(), missing);
+        if (missing > 0) {
+            CHECK_EQUAL(stats.failures[0].first, items[2].input_path);
+            CHECK(stats.failures[0].second.find("could not load image") != std::string::npos);
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            cv::Mat saved = cv::imread(batch[i].output_path, cv::IMREAD_UNCHANGED);
+            CHECK(identical(saved, expected[i]));
+            std::remove(batch[i].output_path.c_str());
+        }
+    }
+    for (const BatchItem& item : items) {
+        std::remove(item.input_path.c_str());
+    }
+}
+
+TEST_CASE(node_costs_are_measured_only_while_used) {
+    cv::Mat frame = testFrame();
+    
+    // sequential runs without a deadline use no costs
+    GraphExecutor executor;
+    executor.loadGraph(branchingGraph());
+    runFrame(executor, frame);
+    CHECK_EQUAL(executor.getNodeCost("side_blur"), 0.0);
+    
+    // a deadline does, and the measurements survive a recompile
+    ExecutionContext context;
+    context.setOutputCapture(true);
+    context.setTimeBudget(std::chrono::milliseconds(10000));
+    context.setInput("in", frame);
+    executor.execute(context);
+    double cost = executor.getNodeCost("side_blur");
+    CHECK(cost > 0.0);
+    executor.setRegionPropagationEnabled(false);
+    CHECK_EQUAL(executor.getNodeCost("side_blur"), cost);
+    CHECK_EQUAL(executor.getNodeCost("unknown"), 0.0);
+    
+    // so does ranked dispatch
+    GraphExecutor ranked;
+    ranked.setExecutionMode(ExecutionMode::Dataflow);
+    ranked.setCriticalPathSchedulingEnabled(true);
+    ranked.setKernelThreading(KernelThreading::Serial);
+    ranked.loadGraph(branchingGraph());
+    runFrame(ranked, frame);
+    CHECK(ranked.getNodeCost("side_blur") > 0.0);
+}
+
+TEST_CASE(deadlines_shed_only_optional_nodes) {
+    // a wide sharpen on a full hd frame takes far longer than the 1 ms budget below, so
+    // once its cost is measured every optional node is projected past the deadline
+    auto optional = [](NodeConfig node) {
+        node.optional = true;
+        return node;
+    };
+    GraphConfig graph = makeGraph({
+        makeNode("in", "input"),
+        optional(makeNode("pre", "contrast", {{"factor", 1.3}, {"brightness_offset", -20}})),
+        makeNode("slow", "sharpen", {{"strength", 0.8}, {"kernel_size", 15}}),
+        optional(makeNode("post", "blur", {{"kernel_size", 5}, {"sigma", 1.2}})),
+        makeNode("out", "output")
+    }, {{"in", "pre"}, {"pre", "slow"}, {"slow", "post"}, {"post", "out"}});
+    GraphConfig required_only = makeGraph({
+        makeNode("in", "input"),
+        makeNode("slow", "sharpen", {{"strength", 0.8}, {"kernel_size", 15}}),
+        makeNode("out", "output")
+    }, {{"in", "slow"}, {"slow", "out"}});
+    
+    cv::Mat frame = testFrame(1920, 1080);
+    GraphExecutor full_reference;
+    full_reference.loadGraph(graph);
+    cv::Mat full = runFrame(full_reference, frame);
+    GraphExecutor degraded_reference;
+    degraded_reference.loadGraph(required_only);
+    cv::Mat degraded = runFrame(degraded_reference, frame);
+    CHECK(!identical(full, degraded));
+    
+    for (ExecutionMode mode : {ExecutionMode::Sequential, ExecutionMode::Parallel, ExecutionMode::Dataflow}) {
+        GraphExecutor executor;
+        executor.setExecutionMode(mode);
+        executor.setThreadCount(2);
+        executor.loadGraph(graph);
+        ExecutionContext context;
+        context.setOutputCapture(true);
+        
+        // a budget that is never reached measures the costs and sheds nothing
+        context.setTimeBudget(std::chrono::milliseconds(3600000));
+        context.setInput("in", frame);
+        CHECK(identical(executor.execute(context), full));
+        CHECK(!context.getStats().degraded);
+        CHECK_EQUAL(context.getStats().shed_nodes, size_t(0));
+        CHECK(executor.getNodeCost("slow") > 1.0);
+        
+        // a tight one sheds both optional nodes, the required sharpen still runs
+        context.setTimeBudget(std::chrono::milliseconds(1));
+        for (int run = 0; run < 2; ++run) {
+            context.setInput("in", frame);
+            CHECK(identical(executor.execute(context), degraded));
+            CHECK(context.getStats().degraded);
+            CHECK_EQUAL(context.getStats().shed_nodes, size_t(2));
+        }
+        
+        // a deadline that already passed cannot shed required nodes either
+        context.setTimeBudget(std::chrono::milliseconds(0));
+        context.setDeadline(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+        context.setInput("in", frame);
+        CHECK(identical(executor.execute(context), degraded));
+        CHECK_EQUAL(context.getStats().shed_nodes, size_t(2));
+        
+        // without a deadline the frame is whole again
+        context.clearDeadline();
+        context.setInput("in", frame);
+        CHECK(identical(executor.execute(context), full));
+        CHECK(!context.getStats().degraded);
+    }
+}
@@ -0,0 +1,234 @@
+#include "test_runner.hpp"
+#include "operations/hpp/operations.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    // brightness of every value one element at a time: the single precision product
+    // saturated to the depth, and 16-bit values clamped to 255 like every other depth
+    cv::Mat scalarBrightness(const cv::Mat& input, double factor) {
+        float scale = static_cast<float>(factor);
+        cv::Mat output(input.size(), input.type());
+        int width = input.cols * input.channels();
+        for (int y = 0; y < input.rows; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (input.depth() == CV_8U) {
+                    output.ptr<uchar>(y)[x] = cv::saturate_cast<uchar>(input.ptr<uchar>(y)[x] * scale);
+                } else {
+                    output.ptr<ushort>(y)[x] = std::min<ushort>(cv::saturate_cast<ushort>(input.ptr<ushort>(y)[x] * scale), 255);
+                }
+            }
+        }
+        return output;
+    }
+    
+    // brightness counting the calls of its execution hooks
+    class HookedBrightness : public BrightnessOperation {
+    public:
+        mutable int pre_calls = 0;
+        mutable int post_calls = 0;
+        mutable double factor_seen = 0.0;
+    
+    protected:
+        bool preExecute(const cv::Mat& input, const ROI& roi, const std::map<std::string, double>& params) const override {
+            ++pre_calls;
+            factor_seen = params.at("factor");
+            return true;
+        }
+        
+        bool postExecute(const cv::Mat& input, const cv::Mat& output, const ROI& roi, const std::map<std::string, double>& params) const override {
+            ++post_calls;
+            return true;
+        }
+    };
+    
+    // the edge metric as first written: canny on the image and the mean magnitude of a
+    // double precision sobel (mirrored border)
+    EdgeCountOperation::Statistics baselineEdgeStatistics(const cv::Mat& gray) {
+        EdgeCountOperation::Statistics stats;
+        cv::Mat edges, grad_x, grad_y, grad_magnitude;
+        cv::Canny(gray, edges, 50, 150);
+        stats.edge_pixels = cv::countNonZero(edges);
+        cv::Sobel(gray, grad_x, CV_64F, 1, 0, 3);
+        cv::Sobel(gray, grad_y, CV_64F, 0, 1, 3);
+        cv::magnitude(grad_x, grad_y, grad_magnitude);
+        stats.mean_magnitude = cv::mean(grad_magnitude)[0];
+        return stats;
+    }
+    
+    // check if two images hold the same values
+    bool identical(const cv::Mat& a, const cv::Mat& b) {
+        return a.size() == b.size() && a.type() == b.type() && cv::norm(a, b, cv::NORM_INF) == 0;
+    }
+}
+
+TEST_CASE(simd_brightness_matches_scalar_saturate_cast) {
+    BrightnessOperation brightness;
+    // widths around the vector length leave a scalar tail; the factors include ties
+    // (x.5 products), saturation and zero
+    const int types[] = {CV_8UC1, CV_8UC3, CV_16UC1, CV_16UC3};
+    const int widths[] = {1, 7, 15, 16, 17, 33, 63, 257};
+    const double factors[] = {0.0, 0.5, 1.0, 1.3, 1.5, 2.5, 4.99, 5.0};
+    for (int type : types) {
+        for (int width : widths) {
+            cv::Mat input(5, width, type);
+            cv::randu(input, 0, CV_MAT_DEPTH(type) == CV_8U ? 256 : 400);
+            for (double factor : factors) {
+                PreparedParametersPtr prepared = brightness.prepare({{"factor", factor}});
+                cv::Mat expected = scalarBrightness(input, factor);
+                CHECK(identical(brightness.run(input, ROI(0, 0, 0, 0, true), *prepared), expected));
+                
+                // in place, and on a roi whose rows are not continuous
+                cv::Mat image = input.clone();
+                CHECK(identical(brightness.runInPlace(image, ROI(0, 0, 0, 0, true), *prepared), expected));
+                if (width > 2) {
+                    ROI roi(1, 1, width - 2, 3);
+                    cv::Mat rect = input(cv::Rect(roi.x, roi.y, roi.width, roi.height));
+                    cv::Mat roi_expected = input.clone();
+                    scalarBrightness(rect, factor).copyTo(roi_expected(cv::Rect(roi.x, roi.y, roi.width, roi.height)));
+                    CHECK(identical(brightness.run(input, roi, *prepared), roi_expected));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(prepared_runs_call_the_execution_hooks) {
+    HookedBrightness brightness;
+    cv::Mat image(8, 8, CV_8UC1, cv::Scalar(100));
+    PreparedParametersPtr prepared = brightness.prepare({{"factor", 1.5}});
+    brightness.run(image, ROI(0, 0, 0, 0, true), *prepared);
+    brightness.runInPlace(image, ROI(0, 0, 0, 0, true), *prepared);
+    brightness.runRegion(image, ROI(0, 0, 0, 0, true), ROI(0, 0, 4, 4), *prepared);
+    CHECK_EQUAL(brightness.pre_calls, 3);
+    CHECK_EQUAL(brightness.post_calls, 3);
+    CHECK_EQUAL(brightness.factor_seen, 1.5);
+    
+    // execute with a map runs the hooks once per call too
+    brightness.execute(image, ROI(0, 0, 0, 0, true), {{"factor", 2.0}});
+    CHECK_EQUAL(brightness.pre_calls, 4);
+    CHECK_EQUAL(brightness.factor_seen, 2.0);
+}
+
+TEST_CASE(invalid_parameters_are_reported_by_the_exception) {
+    BrightnessOperation brightness;
+    CHECK(!brightness.validateParameters({{"factor", 9.0}}));
+    std::string message;
+    try {
+        brightness.prepare({{"factor", 9.0}});
+    } catch (const std::runtime_error& error) {
+        message = error.what();
+    }
+    CHECK(message.find("brightness factor must be between 0.0 and 5.0") != std::string::npos);
+    
+    // a failed call leaves nothing behind for the next one
+    cv::Mat image(8, 8, CV_8UC1, cv::Scalar(100));
+    bool threw = false;
+    try {
+        brightness.execute(image, ROI(0, 0, 0, 0, true), {{"factor", 9.0}});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK_EQUAL(brightness.execute(image, ROI(0, 0, 0, 0, true), {{"factor", 2.0}}).at<uchar>(0, 0), 200);
+}
+
+TEST_CASE(edge_statistics_match_the_double_precision_baseline) {
+    // noise, and blocks with strong edges on the image border where the border mode of
+    // the sobel changes the magnitude; sizes down to a single row or column
+    const cv::Size sizes[] = {{1, 1}, {1, 9}, {9, 1}, {2, 2}, {3, 3}, {17, 5}, {64, 48}, {333, 211}};
+    for (const cv::Size& size : sizes) {
+        for (int pattern = 0; pattern < 2; ++pattern) {
+            cv::Mat gray(size, CV_8UC1);
+            if (pattern == 0) {
+                cv::randu(gray, 0, 256);
+            } else {
+                gray.setTo(0);
+                gray(cv::Rect(0, 0, (size.width + 1) / 2, (size.height + 1) / 2)).setTo(255);
+                gray.col(size.width - 1).setTo(200);
+            }
+            EdgeCountOperation::Statistics expected = baselineEdgeStatistics(gray);
+            EdgeCountOperation::Statistics stats = EdgeCountOperation::measure(gray);
+            CHECK_EQUAL(stats.edge_pixels, expected.edge_pixels);
+            CHECK(std::abs(stats.mean_magnitude - expected.mean_magnitude) <= 1e-6 * std::max(1.0, expected.mean_magnitude));
+        }
+    }
+}
+
+TEST_CASE(roi_blur_and_sharpen_match_gaussian_blur_on_the_submatrix) {
+    // a roi is filtered as a submatrix, reading its real neighbours; on the generic path
+    // the cached kernel gives exactly what GaussianBlur gives on the same submatrix, while
+    // builds where ipp takes over submatrices may round differently (at most by one)
+    const double tolerance = cv::ipp::useIPP() ? 1.0 : 0.0;
+    const cv::Rect rects[] = {{0, 0, 100, 80}, {17, 23, 201, 150}, {250, 200, 83, 100}, {5, 5, 1, 1}, {40, 10, 3, 250}};
+    for (int type : {CV_8UC1, CV_8UC3}) {
+        cv::Mat input(300, 333, type);
+        cv::randu(input, 0, 256);
+        for (int kernel_size : {3, 7, 15}) {
+            BlurOperation blur;
+            PreparedParametersPtr blur_prepared = blur.prepare({{"kernel_size", kernel_size}, {"sigma", 1.7}});
+            SharpenOperation sharpen;
+            PreparedParametersPtr sharpen_prepared = sharpen.prepare({{"kernel_size", kernel_size}, {"strength", 1.3}});
+            for (const cv::Rect& rect : rects) {
+                ROI roi(rect.x, rect.y, rect.width, rect.height);
+                cv::Mat blurred, expected_blur, expected_sharpen;
+                cv::GaussianBlur(input(rect), expected_blur, cv::Size(kernel_size, kernel_size), 1.7);
+                cv::GaussianBlur(input(rect), blurred, cv::Size(kernel_size, kernel_size), 0);
+                cv::addWeighted(input(rect), 2.3, blurred, -1.3, 0, expected_sharpen);
+                
+                // copying and in place, and pixels outside the roi stay as they were
+                cv::Mat output = blur.run(input, roi, *blur_prepared);
+                CHECK(cv::norm(output(rect), expected_blur, cv::NORM_INF) <= tolerance);
+                output(rect).setTo(0);
+                cv::Mat outside = input.clone();
+                outside(rect).setTo(0);
+                CHECK(identical(output, outside));
+                cv::Mat image = input.clone();
+                blur.runInPlace(image, roi, *blur_prepared);
+                CHECK(cv::norm(image(rect), expected_blur, cv::NORM_INF) <= tolerance);
+                
+                output = sharpen.run(input, roi, *sharpen_prepared);
+                CHECK(cv::norm(output(rect), expected_sharpen, cv::NORM_INF) <= tolerance);
+                output(rect).setTo(0);
+                CHECK(identical(output, outside));
+                image = input.clone();
+                sharpen.runInPlace(image, roi, *sharpen_prepared);
+                CHECK(cv::norm(image(rect), expected_sharpen, cv::NORM_INF) <= tolerance);
+            }
+        }
+    }
+}
+
+TEST_CASE(banded_sharpen_matches_gaussian_blur_and_add_weighted) {
+    // about 512 KB of rows per band, so these images span several bands (the last one
+    // partial); odd widths keep rows from lining up with the vector blocks of addWeighted,
+    // and the narrow image has bands of tens of thousands of rows
+    const cv::Size sizes[] = {{333, 2500}, {1001, 2100}, {7, 80000}};
+    for (int channels : {1, 3}) {
+        for (const cv::Size& size : sizes) {
+            cv::Mat input(size, CV_8UC(channels));
+            cv::randu(input, 0, 256);
+            for (int kernel_size : {3, 9, 15}) {
+                SharpenOperation sharpen;
+                PreparedParametersPtr prepared = sharpen.prepare({{"kernel_size", kernel_size}, {"strength", 1.5}});
+                
+                // the whole image
+                cv::Mat blurred, expected;
+                cv::GaussianBlur(input, blurred, cv::Size(kernel_size, kernel_size), 0);
+                cv::addWeighted(input, 2.5, blurred, -1.5, 0, expected);
+                CHECK(identical(sharpen.run(input, ROI(0, 0, 0, 0, true), *prepared), expected));
+                
+                // a roi taller than one band, read as a submatrix with its real neighbours
+                cv::Rect rect(size.width / 5, 37, size.width - size.width / 5 - 3, size.height - 80);
+                cv::GaussianBlur(input(rect), blurred, cv::Size(kernel_size, kernel_size), 0);
+                cv::Mat expected_roi;
+                cv::addWeighted(input(rect), 2.5, blurred, -1.5, 0, expected_roi);
+                cv::Mat output = sharpen.run(input, ROI(rect.x, rect.y, rect.width, rect.height), *prepared);
+                CHECK(identical(output(rect), expected_roi));
+            }
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#include "test_runner.hpp"
+#include <exception>
+#include <iostream>
+
+// every test case linked into the runner
+std::vector<TestCase>& testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+// registers a test case during static initialization
+TestRegistration::TestRegistration(const std::string& name, std::function<void()> run) {
+    testCases().push_back(TestCase{name, std::move(run)});
+}
+
+// run every test case (or only those whose name contains argv[1]) and report failures
+int main(int argc, char* argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    int passed = 0;
+    int failed = 0;
+    for (const auto& test : testCases()) {
+        if (test.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        
+        try {
+            test.run();
+            ++passed;
+            std::cout << "pass: " << test.name << std::endl;
+        } catch (const std::exception& e) {
+            ++failed;
+            std::cout << "FAIL: " << test.name << ": " << e.what() << std::endl;
+        }
+    }
+    
+    std::cout << passed << " passed, " << failed << " failed" << std::endl;
+    return failed == 0 && passed > 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// a named check run by the test runner; it fails by throwing
+struct TestCase {
+    std::string name;
+    std::function<void()> run;
+};
+
+// every test case linked into the runner
+std::vector<TestCase>& testCases();
+
+// registers a test case during static initialization
+struct TestRegistration {
+    TestRegistration(const std::string& name, std::function<void()> run);
+};
+
+// thrown by a failed check
+class TestFailure : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// define a test case: TEST_CASE(name) { ... }
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestRegistration name##_registration(#name, name); \
+    static void name()
+
+// fail the running test case unless condition holds
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::ostringstream message; \
+            message << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition; \
+            throw TestFailure(message.str()); \
+        } \
+    } while (0)
+
+// fail the running test case unless a == b, printing both values
+#define CHECK_EQUAL(a, b) \
+    do { \
+        auto check_a = (a); \
+        auto check_b = (b); \
+        if (!(check_a == check_b)) { \
+            std::ostringstream message; \
+            message << __FILE__ << ":" << __LINE__ << ": check failed: " << #a << " == " << #b \
+                    << " (" << check_a << " vs " << check_b << ")"; \
+            throw TestFailure(message.str()); \
+        } \
+    } while (0)